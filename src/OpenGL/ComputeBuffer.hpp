@@ -10,7 +10,10 @@
 
 #define ensureNotCommited() if(committed) assert(0 && "Error: Cannot add fields after the buffer has been commited!")
 
+class ComputeShader;
+
 class ComputeBuffer {
+friend class ComputeShader;
 protected:
 	unsigned int bufferID = 0,	// Variable storing the ID of the storage buffer
 			bindingPoint;		// Variable storing where the buffer is bound
@@ -69,10 +72,43 @@ public:
 		setData(data.data(), start, finish);
 	}
 
+	// Copies <size> bytes (the rest of <other> if 0) from <other> at <srcOffset> into this buffer at <dstOffset>, without involving the host
+	//  NOTE: GL queues the copy in its command stream, so no explicit synchronization is needed
+	void copyFrom(ComputeBuffer& other, size_t srcOffset = 0, size_t dstOffset = 0, size_t size = 0){
+		if(size < 1) size = other.bufferSize - srcOffset;
+		if(srcOffset + size > other.bufferSize || dstOffset + size > bufferSize) assert(0 && "Error: Copy region is outside of the buffer!");
+
+		// Make sure any shader writes to the buffers are visible to the copy
+		glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+		glBindBuffer(GL_COPY_READ_BUFFER, other.bufferID);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, bufferID);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, srcOffset, dstOffset, size);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0); // Unbind
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+
+	// Fills <size> bytes (the rest of the buffer if 0) starting at <offset> with repeated copies of <value>.
+	//  The offset and size must be multiples of 4.
+	void fill(uint32_t value, size_t offset = 0, size_t size = 0){
+		if(size < 1) size = bufferSize - offset;
+		if(offset % 4 || size % 4) assert(0 && "Error: Fill offset and size must be multiples of 4!");
+		if(offset + size > bufferSize) assert(0 && "Error: Fill region is outside of the buffer!");
+
+		glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, bufferID);
+		glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, offset, size, GL_RED_INTEGER, GL_UNSIGNED_INT, &value);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0); // Unbind
+	}
+
 	unsigned int getBindingPoint(){
 		return bindingPoint;
 	}
 
+	// Binds the buffer at <point> (instead of the binding point it was created with)
+	void bind(unsigned int point){
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, point, bufferID);
+	}
+
 protected:
 	void createBuffer(void* data){
 		// If we got an invalid size for the buffer... error
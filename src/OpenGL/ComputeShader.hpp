@@ -24,6 +24,12 @@ public:
 		if(!programID) assert(0 && "Error: Creating program!");
 	}
 
+	// Creates the shader from GLSL source code
+	ComputeShader(const std::string& src){
+		programID = createProgram(src.c_str());
+		if(!programID) assert(0 && "Error: Creating program!");
+	}
+
 	~ComputeShader(){
 		glDeleteProgram(programID);
 	}
@@ -33,6 +39,20 @@ public:
 		glDispatchCompute(x, y, z);
 	}
 
+	// Dispatches the shader with the group counts read (on the GPU) from <args> at <offset>, which should contain
+	//  three uints (x, y, z) as written by a previous dispatch or upload
+	void dispatchIndirect(ComputeBuffer& args, size_t offset = 0){
+		if(offset % 4) assert(0 && "Error: Indirect dispatch offset must be a multiple of 4!");
+		if(offset + 3 * sizeof(unsigned int) > args.bufferSize) assert(0 && "Error: Indirect dispatch arguments are outside of the buffer!");
+
+		// Make sure shader writes to the arguments are visible to the dispatch
+		glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+		glUseProgram(programID);
+		glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, args.bufferID);
+		glDispatchComputeIndirect(offset);
+		glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0); // Unbind
+	}
+
 	template <class T>
 	T getParameter(const std::string& name){ return getParameter(name, identity<T>()); }
 
@@ -0,0 +1,65 @@
+#ifndef __WORKGROUP_COUNT_KERNEL_H__
+#define __WORKGROUP_COUNT_KERNEL_H__
+#include "ComputeShader.hpp"
+
+#include <string>
+#include <fstream>
+
+// Small kernel which turns an element count produced on the GPU (by a filter or compaction stage for example) into the
+//  workgroup counts needed to process that many elements, written in the layout dispatchIndirect expects. This lets the
+//  next kernel be sized without reading the count back to the host:
+//		counter.compute(countBuffer, 0, argsBuffer, 0, 32);
+//		nextShader.dispatchIndirect(argsBuffer, 0);
+//  The group count is limited to the device's maxComputeWorkGroupCount[0], so at most that many times the local size
+//  elements are covered. The args are followed by a fourth uint holding the number of elements past that limit (0 if
+//  they all fit), which the host can read back to check that nothing was dropped.
+class WorkgroupCountKernel {
+protected:
+	ComputeShader shader;
+
+public:
+	// Reads the kernel's GLSL from <path>, the same file is shared by the OpenGL and Vulkan backends
+	static std::string source(const std::string& path = "src/workgroupCount.glsl"){
+		std::ifstream file(path);
+		if(!file) assert(0 && "Error: Failed to open the workgroup count shader!");
+
+		const char END_OF_FILE = 26;
+		std::string src;
+		getline(file, src, END_OF_FILE);
+		return src;
+	}
+
+	// <path> is relative to the working directory, like the shaders main.cpp loads
+	WorkgroupCountKernel(const std::string& path = "src/workgroupCount.glsl") : shader(source(path)) {}
+
+	// Reads the element count stored in <count> at <countOffset>, and writes the workgroup counts needed to process that
+	//  many elements with <localSize> invocations per group into <args> at <argsOffset> (which needs room for 4 uints)
+	//  NOTE: Temporarily uses binding points 0 and 1, whatever was bound there is restored afterwards
+	void compute(ComputeBuffer& count, size_t countOffset, ComputeBuffer& args, size_t argsOffset, unsigned int localSize){
+		if(countOffset % 4 || argsOffset % 4) assert(0 && "Error: Count and argument offsets must be multiples of 4!");
+		if(!localSize) assert(0 && "Error: Invalid local size!");
+
+		int maxGroups;
+		glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_COUNT, 0, &maxGroups);
+		shader.setParameter("countIndex", int(countOffset / 4));
+		shader.setParameter("argsIndex", int(argsOffset / 4));
+		shader.setParameter("localSize", int(localSize));
+		shader.setParameter("maxGroups", maxGroups);
+
+		// Remember what is bound where we are about to bind our buffers
+		int previous[2];
+		glGetIntegeri_v(GL_SHADER_STORAGE_BUFFER_BINDING, 0, &previous[0]);
+		glGetIntegeri_v(GL_SHADER_STORAGE_BUFFER_BINDING, 1, &previous[1]);
+
+		// Make sure shader writes to the count are visible
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+		count.bind(0);
+		args.bind(1);
+		shader.dispatch(1);
+
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, previous[0]);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, previous[1]);
+	}
+};
+
+#endif // __WORKGROUP_COUNT_KERNEL_H__
@@ -2,23 +2,54 @@
 #define __BOILER_PLATE_VULK_H__
 
 #include "VulkanWrapper.hpp"
+#include "DeviceAllocator.hpp"
+#include "Timeline.hpp"
+#include "StagingRing.hpp"
+#include "PipelineCache.hpp"
+#include "SpirvCache.hpp"
+
+#include <memory>
 
 // Temporary
 #include "../dictionary.hpp"
 #include <fstream>
 
+// Struct storing the tunable parameters used when creating a context
+struct VulkanSettings {
+    vk::DeviceSize allocatorBlockSize = 64 * 1024 * 1024; // Size (in bytes) of the device memory blocks buffers are sub-allocated from
+    vk::DeviceSize stagingRingSize = 16 * 1024 * 1024; // Size (in bytes) of the ring host <-> device transfers are staged through
+    uint32_t stagingRingSlots = 8; // Maximum number of transfers which can be in flight at once
+    std::string pipelineCachePath; // File compiled pipelines are cached in between runs (empty to not persist the cache)
+    std::string spirvCacheDirectory; // Directory compiled shaders are cached in, shared between processes (empty to disable)
+    bool logCaches = false; // Print what the pipeline cache loads and saves
+    bool pushDescriptors = true; // Bind buffers with push descriptors (if the device supports them) instead of cached descriptor sets
+    bool bufferDeviceAddress = true; // Let shaders reach buffers through device addresses (if the device supports them)
+};
+
 // Struct storing all of the general purpose vulkan handles
 struct VulkanContext {
     vk::UniqueInstance instance;
     vk::UniqueDebugUtilsMessengerEXT debugMsgr;
     vk::PhysicalDevice physicalDevice;
+    vk::PhysicalDeviceProperties deviceProperties;
+    bool unifiedMemory = false; // True if device local memory can be accessed directly by the host without penalty (integrated and software devices)
+    uint32_t maxPushDescriptors = 0; // Maximum number of bindings which can be pushed (0 if VK_KHR_push_descriptor isn't enabled)
+    bool bufferDeviceAddress = false; // True if buffers have device addresses (see ComputeBuffer::deviceAddress)
     vk::UniqueDevice device;
+    std::unique_ptr<PipelineCache> pipelineCache; // Saved back to disk when the context is destroyed (or whenever save() is called)
+    std::unique_ptr<SpirvCache> spirvCache;
     uint32_t computeQueueIndex = -1;
     vk::Queue computeQueue;
+    uint32_t transferQueueIndex = -1; // Queue buffer transfers are submitted to (the compute queue if the device only has one queue)
+    vk::Queue transferQueue;
     vk::UniqueCommandPool commandPool;
+    std::unique_ptr<Timeline> computeTimeline; // Signaled by every dispatch
+    std::unique_ptr<Timeline> transferTimeline; // Signaled by every transfer
+    std::unique_ptr<DeviceAllocator> allocator;
+    std::unique_ptr<StagingRing> staging;
 };
 
-static VulkanContext initVulkan(){
+static VulkanContext initVulkan(const VulkanSettings& settings = {}){
     VulkanContext out;
 
     // Determine required vulkan extensions and layers
@@ -35,25 +66,90 @@ static VulkanContext initVulkan(){
 
     // Create Vulkan Device
     out.physicalDevice = out.instance->enumeratePhysicalDevices()[0]; // Actual logic to choose a proper device should go here
+    out.deviceProperties = out.physicalDevice.getProperties();
+    // Determine if the device shares its memory with the host
+    if(out.deviceProperties.deviceType == vk::PhysicalDeviceType::eIntegratedGpu || out.deviceProperties.deviceType == vk::PhysicalDeviceType::eCpu){
+        auto memoryProperties = out.physicalDevice.getMemoryProperties();
+        const auto unified = vk::MemoryPropertyFlagBits::eDeviceLocal | vk::MemoryPropertyFlagBits::eHostVisible;
+        for(uint32_t k = 0; k < memoryProperties.memoryTypeCount; k++)
+            if((memoryProperties.memoryTypes[k].propertyFlags & unified) == unified)
+                out.unifiedMemory = true;
+    }
     // Determine the compute queue index
     auto properties = out.physicalDevice.getQueueFamilyProperties();
     for(uint32_t i = 0; i < properties.size(); i++)
-        if(properties[i].queueFlags & (vk::QueueFlagBits::eCompute | vk::QueueFlagBits::eTransfer)){
+        if(properties[i].queueFlags & vk::QueueFlagBits::eCompute){
             out.computeQueueIndex = i;
             break;
         }
-    float fullPriority = 1;
-    vk::DeviceQueueCreateInfo qci({}, out.computeQueueIndex, 1, &fullPriority);
+    // Determine the transfer queue index, preferring a transfer only family, then another compute family, then a second queue in the compute family
+    uint32_t transferQueue = 0;
+    for(uint32_t i = 0; i < properties.size(); i++)
+        if((properties[i].queueFlags & vk::QueueFlagBits::eTransfer) && !(properties[i].queueFlags & (vk::QueueFlagBits::eCompute | vk::QueueFlagBits::eGraphics))){
+            out.transferQueueIndex = i;
+            break;
+        }
+    if(out.transferQueueIndex == uint32_t(-1))
+        for(uint32_t i = 0; i < properties.size(); i++)
+            if(i != out.computeQueueIndex && (properties[i].queueFlags & vk::QueueFlagBits::eCompute)){
+                out.transferQueueIndex = i;
+                break;
+            }
+    if(out.transferQueueIndex == uint32_t(-1)){
+        out.transferQueueIndex = out.computeQueueIndex;
+        // Fall back to sharing the compute queue if there isn't a second one
+        if(properties[out.computeQueueIndex].queueCount > 1) transferQueue = 1;
+    }
+
+    float fullPriority[] = {1, 1};
+    std::vector<vk::DeviceQueueCreateInfo> qcis;
+    qcis.emplace_back(vk::DeviceQueueCreateFlags(), out.computeQueueIndex, 1 + transferQueue, fullPriority);
+    if(out.transferQueueIndex != out.computeQueueIndex)
+        qcis.emplace_back(vk::DeviceQueueCreateFlags(), out.transferQueueIndex, 1, fullPriority);
     std::vector<const char*> deviceLayers {};
     std::vector<const char*> deviceExtens {};
+    // Push descriptors let per-dispatch bindings be written straight into command buffers
+    if(settings.pushDescriptors)
+        for(auto& extension: out.physicalDevice.enumerateDeviceExtensionProperties())
+            if(std::string(extension.extensionName) == VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME){
+                deviceExtens.push_back(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+                auto chain = out.physicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDevicePushDescriptorPropertiesKHR>();
+                out.maxPushDescriptors = chain.get<vk::PhysicalDevicePushDescriptorPropertiesKHR>().maxPushDescriptors;
+            }
     vk::PhysicalDeviceFeatures features {};
-    out.device = out.physicalDevice.createDeviceUnique( {{}, 1, &qci, (uint32_t) deviceLayers.size(), deviceLayers.data(), (uint32_t) deviceExtens.size(), deviceExtens.data(), &features} );
-    // Refernece the compute queue
+    // Timeline semaphores are used to synchronize the queues
+    vk::PhysicalDeviceVulkan12Features features12 {};
+    features12.timelineSemaphore = true;
+    // Buffer device addresses let one pipeline reach any number of buffers through pointers
+    auto supported = out.physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>().get<vk::PhysicalDeviceVulkan12Features>();
+    out.bufferDeviceAddress = features12.bufferDeviceAddress = settings.bufferDeviceAddress && supported.bufferDeviceAddress;
+    vk::DeviceCreateInfo dci( {}, (uint32_t) qcis.size(), qcis.data(), (uint32_t) deviceLayers.size(), deviceLayers.data(), (uint32_t) deviceExtens.size(), deviceExtens.data(), &features );
+    dci.pNext = &features12;
+    out.device = out.physicalDevice.createDeviceUnique(dci);
+    loadDeviceFunctions(out.device.get());
+    // Refernece the compute and transfer queues
     out.computeQueue = out.device->getQueue(out.computeQueueIndex, 0);
+    out.transferQueue = out.device->getQueue(out.transferQueueIndex, transferQueue);
+
+    // Create the timelines used to synchronize the queues
+    out.computeTimeline.reset( new Timeline(out.device.get()) );
+    out.transferTimeline.reset( new Timeline(out.device.get()) );
+
+    // Load the pipeline cache
+    out.pipelineCache.reset( new PipelineCache(out.device.get(), out.deviceProperties, settings.pipelineCachePath, settings.logCaches) );
+
+    // Open the compiled shader cache
+    out.spirvCache.reset( new SpirvCache(settings.spirvCacheDirectory) );
 
     // Create a command pool
     out.commandPool = out.device->createCommandPoolUnique( {{}, out.computeQueueIndex} );
 
+    // Create the allocator device memory is sub-allocated from
+    out.allocator.reset( new DeviceAllocator(out.physicalDevice, out.device.get(), settings.allocatorBlockSize, out.bufferDeviceAddress) );
+
+    // Create the ring transfers are staged through
+    out.staging.reset( new StagingRing(*out.allocator, out.device.get(), out.transferQueue, out.transferQueueIndex, *out.transferTimeline, *out.computeTimeline, settings.stagingRingSize, settings.stagingRingSlots) );
+
     return out;
 }
 
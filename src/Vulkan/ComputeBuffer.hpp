@@ -5,52 +5,107 @@
 #include <vector>
 #include <cstring>
 #include <cassert>
+#include <algorithm>
+#include <atomic>
 
 #define ensureNotCommited() if(committed) assert(0 && "Error: Cannot add fields after the buffer has been commited!")
 
 class ComputeShader;
+class TransferBatch;
+class ComputeSequence;
+class ComputeBufferPool;
 
 class ComputeBuffer {
 friend class ComputeShader;
+friend class TransferBatch;
+friend class ComputeSequence;
+friend class ComputeBufferPool;
+friend class DeviceAddressTable;
+public:
+	// Where the buffer's memory lives
+	enum class Residency {
+		Automatic,		// Host visible if the device shares its memory with the host, device local otherwise
+		DeviceLocal,	// Device local memory, accessed by the host through the staging ring
+		HostVisible		// Host visible memory which is kept mapped, accessed by the host directly
+	};
+
+	// Typed view of a host visible buffer's memory, flushes any writes to the device when destroyed
+	template <class T>
+	class Span {
+		ComputeBuffer* owner;
+		T* ptr;
+		size_t count;
+
+	public:
+		Span(ComputeBuffer* _owner, T* _ptr, size_t _count) : owner(_owner), ptr(_ptr), count(_count) {}
+		Span(const Span&) = delete;
+		Span(Span&& o) : owner(o.owner), ptr(o.ptr), count(o.count) { o.owner = nullptr; }
+		~Span(){ flush(); }
+
+		// Makes writes through the span visible to the device
+		void flush(){
+			if(owner) owner->flushMapped((uint8_t*) ptr - owner->memory.mapped, count * sizeof(T));
+		}
+
+		T* data() { return ptr; }
+		size_t size() const { return count; }
+		T* begin() { return ptr; }
+		T* end() { return ptr + count; }
+		T& operator[](size_t i) { return ptr[i]; }
+	};
+
 protected:
 	VulkanContext& context;
 
 	unsigned int bindingPoint;	// Variable storing where the buffer is bound
 	vk::DeviceSize bufferSize;	// Variable storing the size (in size_t) of the storage buffer
+	vk::DeviceSize capacity = 0;	// Size the vk::Buffer was created with (can be larger than bufferSize for pooled buffers)
 	bool committed = false;		// Variable used to determine whether or not it is safe to preform opperations on the buffer
+	Residency residency;		// Variable storing where the buffer's memory lives (resolved when the buffer is created)
+	vk::BufferUsageFlags usage = vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eStorageBuffer
+		| vk::BufferUsageFlagBits::eIndirectBuffer;
 
-	vk::DeviceMemory memory = nullptr;
+	DeviceAllocation memory;		// Memory sub-allocated from the context's allocator
 	vk::Buffer buffer = nullptr;
+	uint64_t id = 0;			// Unique identity of the vk::Buffer (changes whenever it is recreated or resized), descriptor sets are cached by it
+
+	uint64_t lastTransfer = 0;	// Transfer timeline value of the last transfer to touch the buffer
+	uint64_t lastCompute = 0;	// Compute timeline value of the last dispatch to use the buffer
+	uint64_t lastComputeWrite = 0;	// Compute timeline value of the last dispatch to write the buffer (0 once a barrier has made the write visible)
 
 public:
-	ComputeBuffer(VulkanContext& c, unsigned int _bindingPoint, vk::DeviceSize size, void* data = nullptr, vk::DeviceSize dataStart = 0, vk::DeviceSize dataEnd = 0)
-	: context(c), bindingPoint(_bindingPoint), bufferSize(size) {
+	ComputeBuffer(VulkanContext& c, unsigned int _bindingPoint, vk::DeviceSize size, void* data = nullptr, vk::DeviceSize dataStart = 0, vk::DeviceSize dataEnd = 0, Residency _residency = Residency::Automatic)
+	: context(c), bindingPoint(_bindingPoint), bufferSize(size), residency(_residency) {
 		createBuffer();
 		if(data) setData(data, dataStart, dataEnd);
 		//createBuffer(data);
 	}
 
 	template <class T>
-	ComputeBuffer(VulkanContext& c, unsigned int _bindingPoint, std::vector<T>& data, vk::DeviceSize dataStart = 0, vk::DeviceSize dataEnd = 0)
-	: context(c), bindingPoint(_bindingPoint) {
+	ComputeBuffer(VulkanContext& c, unsigned int _bindingPoint, std::vector<T>& data, vk::DeviceSize dataStart = 0, vk::DeviceSize dataEnd = 0, Residency _residency = Residency::Automatic)
+	: context(c), bindingPoint(_bindingPoint), residency(_residency) {
 		bufferSize = data.size() * sizeof(data[0]);
 		createBuffer();
 		setData(data.data(), dataStart, dataEnd);
 		// createBuffer(data.data());
 	}
 
-	ComputeBuffer(VulkanContext& c, unsigned int _bindingPoint) : context(c), bindingPoint(_bindingPoint) {}
+	// Creates a buffer which can also be used in the ways specified by <extraUsage>
+	ComputeBuffer(VulkanContext& c, unsigned int _bindingPoint, vk::DeviceSize size, vk::BufferUsageFlags extraUsage, Residency _residency = Residency::Automatic)
+	: context(c), bindingPoint(_bindingPoint), bufferSize(size), residency(_residency) {
+		usage |= extraUsage;
+		createBuffer();
+	}
+
+	ComputeBuffer(VulkanContext& c, unsigned int _bindingPoint, Residency _residency = Residency::Automatic) : context(c), bindingPoint(_bindingPoint), residency(_residency) {}
 
 	virtual ~ComputeBuffer(){
 		release();
 	}
 
 	virtual void release(){
-		// Free the memory associated with this buffer (if nessicary)
-		if(memory){
-			context.device->free(memory);
-			memory = nullptr;
-		}
+		// Make sure the GPU is done with the buffer
+		waitForDevice();
 
 		// Clean up the buffer (if nessicary)
 		if(buffer){
@@ -58,142 +113,315 @@ public:
 			buffer = nullptr;
 		}
 
+		// Return the memory associated with this buffer to the allocator (if nessicary)
+		if(memory)
+			context.allocator->free(memory);
+
 		committed = false;
 	}
 
 	void getData(void* dataStorage, vk::DeviceSize start = 0, vk::DeviceSize finish = 0){
-		if(finish < 1) finish = bufferSize;
+		getDataAsync(dataStorage, start, finish).wait();
+	}
 
-		vk::DeviceSize size = finish - start;
-		if(size == 0) return;
+	template <class T>
+	void getData(std::vector<T>& dataStorage, vk::DeviceSize start = 0, vk::DeviceSize finish = 0){
+		getData(dataStorage.data(), start, finish);
+	}
 
-		vk::CommandBuffer cb = context.device->allocateCommandBuffers( {context.commandPool.get(), vk::CommandBufferLevel::ePrimary, 1} )[0];
-		auto stagingBuffer = createStagingBuffer(size);
+	// Starts reading the data back from the GPU, <dataStorage> must remain valid until the returned transfer completes
+	TransferHandle getDataAsync(void* dataStorage, vk::DeviceSize start = 0, vk::DeviceSize finish = 0){
+		if(finish < 1) finish = bufferSize;
+		if(finish <= start) return {};
+
+		// Host visible buffers can be read directly (once the GPU is done with them)
+		if(isHostVisible()){
+			waitForDevice();
+			invalidateMapped(start, finish - start);
+			memcpy(dataStorage, memory.mapped + start, finish - start);
+			return {};
+		}
 
-		// Queue up a copy from the permanent buffer to the staging buffer
-		cb.begin( {vk::CommandBufferUsageFlagBits::eOneTimeSubmit, nullptr} ); {
-			vk::BufferCopy copy(start, 0, size);
-			cb.copyBuffer(buffer, stagingBuffer.second, copy);
-		} cb.end();
-		vk::SubmitInfo si(0, nullptr, nullptr, 1, &cb, 0, nullptr);
-		context.computeQueue.submit(si);
+		StagingRing& staging = *context.staging;
+		uint8_t* out = (uint8_t*) dataStorage;
+		uint64_t last = 0;
+		// Transfer the data in chunks that fit in the staging ring
+		for(vk::DeviceSize offset = start; offset < finish; ){
+			vk::DeviceSize size = std::min(finish - offset, staging.maxTransferSize());
+			StagingRing::Transfer transfer = staging.begin(size);
+
+			// Queue up a copy from the permanent buffer to the staging ring (after earlier transfers writing the buffer)
+			recordTransferBarrier(transfer.commandBuffer);
+			vk::BufferCopy copy(offset, transfer.offset, size);
+			transfer.commandBuffer.copyBuffer(buffer, transfer.buffer, copy);
+			// Make sure the copy is visible to the host once it completes
+			vk::MemoryBarrier barrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eHostRead);
+			transfer.commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, {}, barrier, nullptr, nullptr);
+
+			// Once the copy completes, copy the data out of the staging ring
+			uint8_t* dst = out + (offset - start);
+			uint8_t* src = transfer.mapped;
+			last = staging.submit(transfer, [dst, src, size]{ memcpy(dst, src, size); }, lastCompute);
+
+			offset += size;
+		}
 
-		// Wait for the copy to complete
-		context.computeQueue.waitIdle();
+		lastTransfer = last;
+		return {&staging, last};
+	}
 
-		// Copy the provided data from the staging buffer
-		void* map = context.device->mapMemory(stagingBuffer.first, 0, size, {});
-		memcpy(dataStorage, map, size);
-		context.device->unmapMemory(stagingBuffer.first);
+	template <class T>
+	TransferHandle getDataAsync(std::vector<T>& dataStorage, vk::DeviceSize start = 0, vk::DeviceSize finish = 0){
+		return getDataAsync(dataStorage.data(), start, finish);
+	}
 
-		// Free all the resources we created
-		context.device->free(stagingBuffer.first);
-		context.device->destroy(stagingBuffer.second);
-		context.device->freeCommandBuffers(context.commandPool.get(), 1, &cb);
+	void setData(void* data, vk::DeviceSize start = 0, vk::DeviceSize finish = 0){
+		setDataAsync(data, start, finish).wait();
 	}
 
 	template <class T>
-	void getData(std::vector<T>& dataStorage, vk::DeviceSize start = 0, vk::DeviceSize finish = 0){
-		getData(dataStorage.data(), start, finish);
+	void setData(std::vector<T>& data, vk::DeviceSize start = 0, vk::DeviceSize finish = 0){
+		setData(data.data(), start, finish);
 	}
 
-	void setData(void* data, vk::DeviceSize start = 0, vk::DeviceSize finish = 0){
+	// Starts uploading the data to the GPU, <data> is copied before this returns and can be reused immediately
+	TransferHandle setDataAsync(void* data, vk::DeviceSize start = 0, vk::DeviceSize finish = 0){
 		if(finish < 1) finish = bufferSize;
+		if(finish <= start) return {};
+
+		// Host visible buffers can be written directly (once the GPU is done with them)
+		if(isHostVisible()){
+			waitForDevice();
+			memcpy(memory.mapped + start, data, finish - start);
+			flushMapped(start, finish - start);
+			return {};
+		}
 
-		vk::DeviceSize size = finish - start;
-		if(size == 0) return;
-
-		vk::CommandBuffer cb = context.device->allocateCommandBuffers( {context.commandPool.get(), vk::CommandBufferLevel::ePrimary, 1} )[0];
-		auto stagingBuffer = createStagingBuffer(size);
+		StagingRing& staging = *context.staging;
+		uint8_t* in = (uint8_t*) data;
+		uint64_t last = 0;
+		// Transfer the data in chunks that fit in the staging ring (filling the next chunk while the previous is in flight)
+		for(vk::DeviceSize offset = start; offset < finish; ){
+			vk::DeviceSize size = std::min(finish - offset, staging.maxTransferSize());
+			StagingRing::Transfer transfer = staging.begin(size);
 
-		// Copy the provided data to the staging buffer
-		void* map = context.device->mapMemory(stagingBuffer.first, 0, size, {});
-		memcpy(map, data, size);
-		context.device->unmapMemory(stagingBuffer.first);
+			// Copy the provided data to the staging ring
+			memcpy(transfer.mapped, in + (offset - start), size);
 
-		// Queue up a copy from the staging buffer to the permanent buffer
-		cb.begin( {vk::CommandBufferUsageFlagBits::eOneTimeSubmit, nullptr} ); {
-			vk::BufferCopy copy(0, start, size);
-			cb.copyBuffer(stagingBuffer.second, buffer, copy);
-		} cb.end();
-		vk::SubmitInfo si(0, nullptr, nullptr, 1, &cb, 0, nullptr);
-		context.computeQueue.submit(si);
+			// Queue up a copy from the staging ring to the permanent buffer (after earlier transfers touching the buffer)
+			recordTransferBarrier(transfer.commandBuffer);
+			vk::BufferCopy copy(transfer.offset, offset, size);
+			transfer.commandBuffer.copyBuffer(transfer.buffer, buffer, copy);
+			last = staging.submit(transfer, {}, lastCompute);
 
-		// Wait for the copy to complete
-		context.computeQueue.waitIdle();
+			offset += size;
+		}
 
-		// Free all the resources we created
-		context.device->free(stagingBuffer.first);
-		context.device->destroy(stagingBuffer.second);
-		context.device->freeCommandBuffers(context.commandPool.get(), 1, &cb);
+		lastTransfer = last;
+		return {&staging, last};
 	}
 
 	template <class T>
-	void setData(std::vector<T>& data, vk::DeviceSize start = 0, vk::DeviceSize finish = 0){
-		setData(data.data(), start, finish);
+	TransferHandle setDataAsync(std::vector<T>& data, vk::DeviceSize start = 0, vk::DeviceSize finish = 0){
+		return setDataAsync(data.data(), start, finish);
+	}
+
+
+	/////  Device Side Operations  /////
+
+	// Copies <size> bytes (the rest of <other> if 0) from <other> at <srcOffset> into this buffer at <dstOffset>, without involving the host
+	void copyFrom(ComputeBuffer& other, vk::DeviceSize srcOffset = 0, vk::DeviceSize dstOffset = 0, vk::DeviceSize size = 0){
+		copyFromAsync(other, srcOffset, dstOffset, size).wait();
+	}
+
+	TransferHandle copyFromAsync(ComputeBuffer& other, vk::DeviceSize srcOffset = 0, vk::DeviceSize dstOffset = 0, vk::DeviceSize size = 0){
+		StagingRing& staging = *context.staging;
+		StagingRing::Transfer transfer = staging.begin(0);
+
+		recordTransferBarrier(transfer.commandBuffer);
+		recordCopyFrom(transfer.commandBuffer, other, srcOffset, dstOffset, size);
+		recordHostBarrier(transfer.commandBuffer);
+
+		uint64_t serial = staging.submit(transfer, {}, std::max(lastCompute, other.lastCompute));
+		lastTransfer = other.lastTransfer = serial;
+		return {&staging, serial};
+	}
+
+	// Records a copy from <other> into this buffer into a command buffer (the caller is responsible for synchronization)
+	void recordCopyFrom(vk::CommandBuffer cb, ComputeBuffer& other, vk::DeviceSize srcOffset = 0, vk::DeviceSize dstOffset = 0, vk::DeviceSize size = 0){
+		if(size < 1) size = other.bufferSize - srcOffset;
+		if(srcOffset + size > other.bufferSize || dstOffset + size > bufferSize) assert(0 && "Error: Copy region is outside of the buffer!");
+
+		vk::BufferCopy copy(srcOffset, dstOffset, size);
+		cb.copyBuffer(other.buffer, buffer, copy);
+	}
+
+	// Fills <size> bytes (the rest of the buffer if 0) starting at <offset> with repeated copies of <value>.
+	//  The offset and size must be multiples of 4.
+	void fill(uint32_t value, vk::DeviceSize offset = 0, vk::DeviceSize size = 0){
+		fillAsync(value, offset, size).wait();
+	}
+
+	TransferHandle fillAsync(uint32_t value, vk::DeviceSize offset = 0, vk::DeviceSize size = 0){
+		StagingRing& staging = *context.staging;
+		StagingRing::Transfer transfer = staging.begin(0);
+
+		recordTransferBarrier(transfer.commandBuffer);
+		recordFill(transfer.commandBuffer, value, offset, size);
+		recordHostBarrier(transfer.commandBuffer);
+
+		lastTransfer = staging.submit(transfer, {}, lastCompute);
+		return {&staging, lastTransfer};
+	}
+
+	// Records a fill of this buffer into a command buffer (the caller is responsible for synchronization)
+	void recordFill(vk::CommandBuffer cb, uint32_t value, vk::DeviceSize offset = 0, vk::DeviceSize size = 0){
+		if(size < 1) size = bufferSize - offset;
+		if(offset % 4 || size % 4) assert(0 && "Error: Fill offset and size must be multiples of 4!");
+		if(offset + size > bufferSize) assert(0 && "Error: Fill region is outside of the buffer!");
+
+		cb.fillBuffer(buffer, offset, size, value);
 	}
 
 	unsigned int getBindingPoint(){
 		return bindingPoint;
 	}
 
+	void setBindingPoint(unsigned int _bindingPoint){
+		bindingPoint = _bindingPoint;
+	}
+
+	vk::DeviceSize size(){
+		return bufferSize;
+	}
+
+	Residency getResidency(){
+		return residency;
+	}
+
+	bool isHostVisible(){
+		return residency == Residency::HostVisible;
+	}
+
+	vk::BufferUsageFlags getUsage(){
+		return usage;
+	}
+
+	// Address of the buffer on the device, which shaders can dereference as a GL_EXT_buffer_reference pointer
+	//  instead of accessing the buffer through a binding point (see DeviceAddressTable)
+	vk::DeviceAddress deviceAddress(){
+		if(!context.bufferDeviceAddress) assert(0 && "Error: Buffer device addresses aren't supported by the device!");
+		return context.device->getBufferAddress( {buffer} );
+	}
+
+	// Returns true if no transfers or dispatches using the buffer are still in flight
+	bool isIdle(){
+		return context.staging->ready(lastTransfer) && context.computeTimeline->reached(lastCompute);
+	}
+
+	// Provides direct access to the memory of a host visible buffer (the elements from <start> up to <finish>, measured in T)
+	//  Writes become visible to the device when the span is destroyed or flushed.
+	template <class T>
+	Span<T> map(size_t start = 0, size_t finish = 0){
+		if(!isHostVisible()) assert(0 && "Error: Only host visible buffers can be mapped!");
+		if(finish < 1) finish = bufferSize / sizeof(T);
+
+		// Make sure the device is done with the buffer, and any writes from it are visible to us
+		waitForDevice();
+		invalidateMapped(start * sizeof(T), (finish - start) * sizeof(T));
+		return Span<T>(this, (T*) memory.mapped + start, finish - start);
+	}
+
 protected:
 	void createBuffer(){
-		// Create the Vulkan Buffer
-		buffer = context.device->createBuffer( {{}, bufferSize, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eStorageBuffer, vk::SharingMode::eExclusive, 1, &context.computeQueueIndex} );
+		// Create the Vulkan Buffer (shared between the compute and transfer queues if they are in different families)
+		uint32_t families[] = {context.computeQueueIndex, context.transferQueueIndex};
+		bool shared = families[0] != families[1];
+		if(context.bufferDeviceAddress) usage |= vk::BufferUsageFlagBits::eShaderDeviceAddress;
+		capacity = bufferSize;
+		buffer = context.device->createBuffer( {{}, capacity, usage, shared ? vk::SharingMode::eConcurrent : vk::SharingMode::eExclusive, shared ? 2u : 1u, families} );
+		id = nextId();
 		auto requirements = context.device->getBufferMemoryRequirements(buffer);
-		vk::DeviceSize actualSize = bufferSize;
-		if(requirements.size > actualSize) actualSize = requirements.size;
-
-		// Pick the memory type for this buffer
-		auto properties = context.physicalDevice.getMemoryProperties();
-		uint32_t memoryTypeIndex = -1;
-		for (uint32_t k = 0; k < properties.memoryTypeCount; k++) {
-			const VkMemoryType memoryType = properties.memoryTypes[k];
-			if ( (actualSize < properties.memoryHeaps[memoryType.heapIndex].size) ) {
-				memoryTypeIndex = k;
-				break;
-			}
-		}
-		// Allocate memory on the GPU for this buffer
-		memory = context.device->allocateMemory( {actualSize, memoryTypeIndex} );
+
+		// Sub-allocate memory on the GPU for this buffer
+		if(residency == Residency::Automatic)
+			residency = context.unifiedMemory ? Residency::HostVisible : Residency::DeviceLocal;
+		if(residency == Residency::HostVisible)
+			memory = context.allocator->allocate(requirements, vk::MemoryPropertyFlagBits::eHostVisible, vk::MemoryPropertyFlagBits::eDeviceLocal | vk::MemoryPropertyFlagBits::eHostCoherent);
+		else
+			memory = context.allocator->allocate(requirements, {}, vk::MemoryPropertyFlagBits::eDeviceLocal);
 
 		// Bind it to the memory on the GPU
-		context.device->bindBufferMemory(buffer, memory, 0);
+		context.device->bindBufferMemory(buffer, memory.memory, memory.offset);
 
 		committed = true;
 	}
 
+	static uint64_t nextId(){
+		static std::atomic<uint64_t> counter{0};
+		return ++counter;
+	}
+
 	void createBuffer(void* data){
 		createBuffer();
 		setData(data);
 	}
 
-	std::pair<vk::DeviceMemory, vk::Buffer> createStagingBuffer(vk::DeviceSize size){
-		// Create the staging buffer
-		vk::Buffer buf = context.device->createBuffer( {{}, size, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eStorageBuffer, vk::SharingMode::eExclusive, 1, &context.computeQueueIndex} );
-		auto requirements = context.device->getBufferMemoryRequirements(buf);
-		if(requirements.size > size) size = requirements.size;
-
-		// Pick the memory type for this buffer
-		auto properties = context.physicalDevice.getMemoryProperties();
-		uint32_t memoryTypeIndex = -1;
-		for (uint32_t k = 0; k < properties.memoryTypeCount; k++) {
-			const VkMemoryType memoryType = properties.memoryTypes[k];
-			if ( (VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT & memoryType.propertyFlags)
-			  && (VK_MEMORY_PROPERTY_HOST_COHERENT_BIT & memoryType.propertyFlags)
-			  && (size < properties.memoryHeaps[memoryType.heapIndex].size) ) {
-				memoryTypeIndex = k;
-				break;
-			}
-		}
-		// Allocate memory on the GPU for this buffer
-		vk::DeviceMemory mem = context.device->allocateMemory( {size, memoryTypeIndex} );
+	// Blocks until any transfers or dispatches using the buffer have finished
+	void waitForDevice(){
+		if(lastTransfer) context.staging->wait(lastTransfer);
+		context.computeTimeline->wait(lastCompute);
+	}
 
-		// Bind it to the memory on the GPU
-		context.device->bindBufferMemory(buf, mem, 0);
+	// Makes a transfer's writes to a host visible buffer visible to the host once it completes
+	void recordHostBarrier(vk::CommandBuffer cb){
+		if(!isHostVisible()) return;
+		vk::MemoryBarrier barrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eHostRead | vk::AccessFlagBits::eHostWrite);
+		cb.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, {}, barrier, nullptr, nullptr);
+	}
+
+	// Limits the buffer to the first <size> bytes of its memory, so a pooled buffer created for a whole size class
+	//  transfers, binds, and reports only the size it was requested with
+	void setLogicalSize(vk::DeviceSize size){
+		if(size > capacity) assert(0 && "Error: Size is larger than the buffer was created with!");
+		// Descriptor sets and recordings bind the buffer's size, so a new size needs a new identity
+		if(size != bufferSize) id = nextId();
+		bufferSize = size;
+	}
+
+	// Makes sure earlier transfers on the queue have landed before the recorded commands touch their buffers
+	static void recordTransferBarrier(vk::CommandBuffer cb){
+		vk::MemoryBarrier barrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite);
+		cb.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, {}, barrier, nullptr, nullptr);
+	}
+
+	// Called by ComputeShader::dispatch before it uses the buffer
+	virtual void prepareForDispatch() {}
+
+	// Makes host writes to the given range of a host visible buffer visible to the device (if the memory isn't coherent)
+	void flushMapped(vk::DeviceSize offset, vk::DeviceSize size){
+		vk::MappedMemoryRange range;
+		if(nonCoherentRange(offset, size, range)) context.device->flushMappedMemoryRanges(range);
+	}
+
+	// Makes device writes to the given range of a host visible buffer visible to the host (if the memory isn't coherent)
+	void invalidateMapped(vk::DeviceSize offset, vk::DeviceSize size){
+		vk::MappedMemoryRange range;
+		if(nonCoherentRange(offset, size, range)) context.device->invalidateMappedMemoryRanges(range);
+	}
 
-		return {mem, buf};
+	// Calculates the range of memory which needs to be flushed or invalidated, returns false if the memory is coherent
+	bool nonCoherentRange(vk::DeviceSize offset, vk::DeviceSize size, vk::MappedMemoryRange& range){
+		if(context.allocator->memoryTypeFlags(memory.memoryType) & vk::MemoryPropertyFlagBits::eHostCoherent) return false;
+
+		// The range must be aligned to the atom size (relative to the start of the memory object)
+		const vk::DeviceSize atom = context.deviceProperties.limits.nonCoherentAtomSize;
+		vk::DeviceSize begin = (memory.offset + offset) / atom * atom;
+		vk::DeviceSize end = (memory.offset + offset + size + atom - 1) / atom * atom;
+		range = vk::MappedMemoryRange(memory.memory, begin, end - begin);
+		// Allocations with their own memory might not extend to the end of the last atom
+		if(memory.sizeClass == uint32_t(-1) && end > memory.size) range.size = VK_WHOLE_SIZE;
+		return true;
 	}
 };
 
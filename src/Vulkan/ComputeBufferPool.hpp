@@ -0,0 +1,176 @@
+#ifndef __COMPUTE_BUFFER_POOL_VULK_H__
+#define __COMPUTE_BUFFER_POOL_VULK_H__
+#include "ComputeBuffer.hpp"
+
+#include <map>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <tuple>
+
+// Recycles ComputeBuffers used as temporaries. Buffers are bucketed by power of two size class, usage flags, and
+//  residency; leases return their buffer to the pool when destroyed, and a returned buffer isn't handed out again until
+//  the GPU is done with it. Buffers which have sat unused for longer than the idle timeout are destroyed.
+//  NOTE: The pool must outlive any leases taken from it.
+class ComputeBufferPool {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	struct Stats {
+		uint64_t hits = 0;		// Requests satisfied by a recycled buffer
+		uint64_t misses = 0;	// Requests which had to create a new buffer
+		uint64_t trimmed = 0;	// Buffers destroyed for sitting idle too long
+		size_t idle = 0;		// Buffers currently waiting in the pool
+		size_t leased = 0;		// Buffers currently leased out
+	};
+
+	// Exclusive use of a buffer from the pool, returned to the pool when destroyed
+	class Lease {
+		ComputeBufferPool* pool = nullptr;
+		ComputeBuffer* buffer = nullptr;
+
+	public:
+		Lease() = default;
+		Lease(ComputeBufferPool* _pool, ComputeBuffer* _buffer) : pool(_pool), buffer(_buffer) {}
+		Lease(const Lease&) = delete;
+		Lease& operator=(const Lease&) = delete;
+		Lease(Lease&& o) : pool(o.pool), buffer(o.buffer) { o.buffer = nullptr; }
+		Lease& operator=(Lease&& o){
+			release();
+			pool = o.pool;
+			buffer = o.buffer;
+			o.buffer = nullptr;
+			return *this;
+		}
+		~Lease(){ release(); }
+
+		// Gives the buffer back to the pool early
+		void release(){
+			if(buffer) pool->giveBack(buffer);
+			buffer = nullptr;
+		}
+
+		ComputeBuffer* get() { return buffer; }
+		ComputeBuffer& operator*() { return *buffer; }
+		ComputeBuffer* operator->() { return buffer; }
+		explicit operator bool() const { return buffer; }
+	};
+
+protected:
+	struct Key {
+		uint32_t sizeClass;
+		VkBufferUsageFlags usage;
+		ComputeBuffer::Residency residency;
+
+		bool operator<(const Key& o) const {
+			return std::tie(sizeClass, usage, residency) < std::tie(o.sizeClass, o.usage, o.residency);
+		}
+	};
+
+	struct Idle {
+		ComputeBuffer* buffer;
+		Clock::time_point since;	// When the buffer was returned
+	};
+
+	VulkanContext& context;
+	Clock::duration idleTimeout;
+	std::map<Key, std::vector<Idle>> idle;	// Returned buffers, most recently returned last
+	std::map<ComputeBuffer*, Key> leased;	// Leased buffers, and the bucket they belong in
+	Stats stats;
+
+public:
+	// Smallest size class (every pooled buffer is at least this large)
+	static constexpr vk::DeviceSize minClassSize = 256;
+
+	ComputeBufferPool(VulkanContext& _context, Clock::duration _idleTimeout = std::chrono::seconds(5))
+	: context(_context), idleTimeout(_idleTimeout) {}
+
+	ComputeBufferPool(const ComputeBufferPool&) = delete;
+	ComputeBufferPool& operator=(const ComputeBufferPool&) = delete;
+
+	~ComputeBufferPool(){
+		if(!leased.empty()) assert(0 && "Error: Compute buffer pool destroyed while buffers are still leased!");
+		for(auto& bucket: idle)
+			for(Idle& i: bucket.second)
+				delete i.buffer;
+	}
+
+	// Leases a buffer <size> bytes large (which can also be used as specified by <extraUsage>). The buffer comes from
+	//  the bucket of its size class, but its size (for transfers and bindings) is the one requested.
+	Lease acquire(vk::DeviceSize size, unsigned int bindingPoint = 0, vk::BufferUsageFlags extraUsage = {}, ComputeBuffer::Residency residency = ComputeBuffer::Residency::Automatic){
+		trim();
+
+		// Automatic residency resolves the same way for every buffer, so resolve it now to share buckets
+		if(residency == ComputeBuffer::Residency::Automatic)
+			residency = context.unifiedMemory ? ComputeBuffer::Residency::HostVisible : ComputeBuffer::Residency::DeviceLocal;
+
+		Key key = {0, VkBufferUsageFlags(extraUsage), residency};
+		while(classSize(key.sizeClass) < size) key.sizeClass++;
+
+		// Find the most recently returned buffer the GPU is done with
+		ComputeBuffer* buffer = nullptr;
+		auto bucket = idle.find(key);
+		if(bucket != idle.end())
+			for(size_t i = bucket->second.size(); i-- > 0; )
+				if(bucket->second[i].buffer->isIdle()){
+					buffer = bucket->second[i].buffer;
+					bucket->second.erase(bucket->second.begin() + i);
+					break;
+				}
+
+		if(buffer){
+			stats.hits++;
+			buffer->setBindingPoint(bindingPoint);
+		} else {
+			stats.misses++;
+			buffer = new ComputeBuffer(context, bindingPoint, classSize(key.sizeClass), extraUsage, residency);
+		}
+		buffer->setLogicalSize(size ? size : classSize(key.sizeClass));
+
+		leased[buffer] = key;
+		return Lease(this, buffer);
+	}
+
+	// Destroys any buffers which have been idle for longer than the timeout
+	void trim(){
+		Clock::time_point cutoff = Clock::now() - idleTimeout;
+		for(auto bucket = idle.begin(); bucket != idle.end(); ){
+			std::vector<Idle>& buffers = bucket->second;
+			// Buffers are in the order they were returned, so the expired ones are at the front
+			size_t expired = 0;
+			while(expired < buffers.size() && buffers[expired].since < cutoff){
+				delete buffers[expired].buffer;
+				expired++;
+			}
+			buffers.erase(buffers.begin(), buffers.begin() + expired);
+			stats.trimmed += expired;
+
+			if(buffers.empty()) bucket = idle.erase(bucket);
+			else bucket++;
+		}
+	}
+
+	Stats getStats(){
+		Stats out = stats;
+		out.idle = 0;
+		for(auto& bucket: idle)
+			out.idle += bucket.second.size();
+		out.leased = leased.size();
+		return out;
+	}
+
+protected:
+	static vk::DeviceSize classSize(uint32_t sizeClass){
+		return minClassSize << sizeClass;
+	}
+
+	void giveBack(ComputeBuffer* buffer){
+		auto lease = leased.find(buffer);
+		if(lease == leased.end()) assert(0 && "Error: Buffer doesn't belong to this pool!");
+
+		idle[lease->second].push_back( {buffer, Clock::now()} );
+		leased.erase(lease);
+	}
+};
+
+#endif // __COMPUTE_BUFFER_POOL_VULK_H__
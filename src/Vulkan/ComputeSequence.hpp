@@ -0,0 +1,475 @@
+#ifndef __COMPUTE_SEQUENCE_VULK_H__
+#define __COMPUTE_SEQUENCE_VULK_H__
+#include "ComputeShader.hpp"
+
+#include <vector>
+#include <map>
+#include <memory>
+
+// Records a list of dispatches, buffer copies, and fills into a single command buffer which is submitted (and can be
+//  resubmitted any number of times) as one unit. Barriers are only placed between steps which actually depend on each
+//  other: a buffer written by one step is made visible to the next step which accesses it, and a buffer read by one
+//  step isn't overwritten until the read has finished. Which buffers a dispatch reads and writes comes from its
+//  shader's SPIR-V reflection, so dispatches of independent kernels aren't separated by barriers and can overlap.
+// The buffers a dispatch uses are the ones bound to its shader when the step is added, so a shader can be dispatched
+//  on different buffers within one sequence. Buffers the shader created (or leased from a pool) are kept alive by the
+//  sequence even if the shader replaces them, buffers bound with bindComputeBuffer must outlive it. Recreating one of a
+//  step's buffers causes the sequence to be re-recorded (once earlier submissions finish) on its next submission.
+//  Uniform blocks are copied into a ring of buffers owned by the sequence, so changing a step's uniforms only writes
+//  the next copy (each copy has its own recording, binding it with a dynamic offset). Changing a step's push constants
+//  re-records just the next copy's command buffer, so neither waits for the submission still in flight.
+class ComputeSequence {
+protected:
+	enum class StepType { Dispatch, Copy, Fill };
+
+	// How a step accesses a buffer
+	struct Access {
+		ComputeBuffer* buffer;
+		bool read, write;
+	};
+
+	struct Step {
+		StepType type;
+		// Dispatch
+		ComputeShader* shader = nullptr;
+		vk::Pipeline pipeline;		// Specialized pipeline (the shader's own pipeline if null)
+		uint32_t x = 1, y = 1, z = 1;
+		std::vector<uint8_t> pushConstants;
+		std::vector<uint8_t> uniforms;		// The shader's uniform block (empty if it doesn't have one)
+		vk::DeviceSize uniformOffset = 0;	// Where the block is stored in each copy of the sequence's uniforms
+		std::vector<ComputeBuffer*> bound;	// Buffer bound at each of the shader's bindings when the step was added
+		std::vector<uint64_t> boundIds;
+		std::vector<std::shared_ptr<void>> owners;	// Keep the buffers the shader owned when the step was added alive
+		size_t descriptor = -1;				// The shader's cached descriptor set referring to those buffers
+		uint64_t descriptorGeneration = 0;
+		std::vector<ComputeBuffer*> addressed;	// Buffers the shader reaches through device addresses
+		DeviceAddressTable* addressTable = nullptr;	// Table they were taken from (if the shader was given one)
+		// Copy and fill
+		ComputeBuffer *src = nullptr, *dst = nullptr;
+		vk::DeviceSize srcOffset = 0, dstOffset = 0, size = 0;
+		uint32_t value = 0;
+
+		std::vector<Access> accesses;
+	};
+
+	// What has happened to a buffer so far while recording
+	struct BufferState {
+		vk::PipelineStageFlags writeStage;		// Stage (and access) of the last write, empty if not written
+		vk::AccessFlags writeAccess;
+		vk::PipelineStageFlags visibleStages;	// Stages the last write has already been made visible to
+		vk::PipelineStageFlags readStages;		// Stages which have read the buffer since the last write
+	};
+
+	VulkanContext& context;
+	std::vector<Step> steps;
+
+	vk::UniqueCommandPool commandPool;
+	std::vector<vk::CommandBuffer> cbs;	// One recording per copy of the uniforms
+	std::vector<bool> copyRecorded;		// Whether each recording is current (false once the push constants change)
+	std::vector<uint64_t> copyUsed;		// Compute timeline value signaled by the last submission of each recording
+	bool recorded = false;				// Whether descriptor sets and uniform offsets have been worked out for the steps
+	uint64_t lastSubmit = 0;	// Compute timeline value signaled by the most recent submission
+
+	// Each dispatch's uniform block, the shaders' own rings are overwritten as their uniforms change but the sequence
+	//  can be resubmitted at any time. The blocks are stored in several copies, so new values can be written while an
+	//  earlier submission still reads the previous ones.
+	std::unique_ptr<ComputeBuffer> uniformBuffer;
+	vk::DeviceSize uniformStride = 0;	// Distance between the copies (0 if no dispatch has a uniform block)
+	uint32_t uniformCopy = 0;			// Copy holding the current values
+	bool uniformsChanged = true;		// Whether the next submission needs a new copy (the uniforms or push constants changed)
+	vk::UniqueDescriptorPool uniformPool;
+	std::map<ComputeShader*, vk::DescriptorSet> uniformSets;	// Set binding the uniform buffer, for each shader
+
+	// Number of copies of the uniforms (and recordings of the sequence)
+	static constexpr uint32_t uniformCopies = 4;
+
+public:
+	ComputeSequence(VulkanContext& _context) : context(_context) {
+		commandPool = context.device->createCommandPoolUnique( {vk::CommandPoolCreateFlagBits::eResetCommandBuffer, context.computeQueueIndex} );
+		cbs = context.device->allocateCommandBuffers( {commandPool.get(), vk::CommandBufferLevel::ePrimary, uniformCopies} );
+		copyRecorded.assign(uniformCopies, false);
+		copyUsed.assign(uniformCopies, 0);
+	}
+
+	ComputeSequence(const ComputeSequence&) = delete;
+	ComputeSequence& operator=(const ComputeSequence&) = delete;
+
+	~ComputeSequence(){
+		context.computeTimeline->wait(lastSubmit);
+	}
+
+
+	/////  Steps  /////
+
+	// Adds a dispatch of <shader> (using its current bindings and push constants), returns the index of the step
+	size_t dispatch(ComputeShader& shader, uint32_t x, uint32_t y = 1, uint32_t z = 1){
+		Step step;
+		step.type = StepType::Dispatch;
+		step.shader = &shader;
+		step.x = x; step.y = y; step.z = z;
+		step.pushConstants = shader.getPushConstants();
+		step.uniforms = shader.getUniforms();
+		captureBindings(step);
+		return addStep(step);
+	}
+
+	// Adds a dispatch of a specialized version of a shader
+	size_t dispatch(ComputeShader::Variant& variant, uint32_t x, uint32_t y = 1, uint32_t z = 1){
+		size_t step = dispatch(variant.getShader(), x, y, z);
+		steps[step].pipeline = variant.getPipeline();
+		return step;
+	}
+
+	size_t dispatchElements(ComputeShader::Variant& variant, size_t elements){
+		return dispatch(variant, variant.groupsForElements(elements));
+	}
+
+	// Adds a dispatch of <shader> with enough workgroups for <elements> invocations (see ComputeShader::dispatchElements)
+	size_t dispatchElements(ComputeShader& shader, size_t elements){
+		return dispatch(shader, shader.groupsForElements(elements));
+	}
+
+	// Adds a copy of <size> bytes (the rest of <src> if 0) from <src> at <srcOffset> into <dst> at <dstOffset>
+	size_t copy(ComputeBuffer& dst, ComputeBuffer& src, vk::DeviceSize srcOffset = 0, vk::DeviceSize dstOffset = 0, vk::DeviceSize size = 0){
+		Step step;
+		step.type = StepType::Copy;
+		step.src = &src;
+		step.dst = &dst;
+		step.srcOffset = srcOffset;
+		step.dstOffset = dstOffset;
+		step.size = size;
+		step.accesses = { {&src, true, false}, {&dst, false, true} };
+		return addStep(step);
+	}
+
+	// Adds a fill of <size> bytes (the rest of the buffer if 0) of <dst> starting at <offset> with <value>
+	size_t fill(ComputeBuffer& dst, uint32_t value, vk::DeviceSize offset = 0, vk::DeviceSize size = 0){
+		Step step;
+		step.type = StepType::Fill;
+		step.dst = &dst;
+		step.value = value;
+		step.dstOffset = offset;
+		step.size = size;
+		step.accesses = { {&dst, false, true} };
+		return addStep(step);
+	}
+
+	// Replaces the push constants used by the dispatch at <step>. Only the recording of the next copy is redone on the
+	//  next submission, so the submission still in flight isn't waited on.
+	void setPushConstants(size_t step, std::vector<uint8_t> data){
+		if(step >= steps.size() || steps[step].type != StepType::Dispatch) assert(0 && "Error: Push constants can only be set on dispatch steps!");
+		if(data.size() % 4 != 0) data.resize(data.size() + 4 - data.size() % 4);
+		if(data == steps[step].pushConstants) return;
+		if(recorded && data.size() > steps[step].shader->pushConstants.size())
+			assert(0 && "Error: Push constants are larger than the shader's pipeline was created with!");
+
+		steps[step].pushConstants = data;
+		// Every recording has the old values baked in, they are redone as each copy comes around again
+		copyRecorded.assign(uniformCopies, false);
+		uniformsChanged = true;
+	}
+
+	template<class T>
+	void setPushConstants(size_t step, T strct){
+		std::vector<uint8_t> data(sizeof(T));
+		memcpy(data.data(), &strct, sizeof(T));
+		setPushConstants(step, data);
+	}
+
+	// Replaces the uniform block used by the dispatch at <step>. The values are written into the next copy of the
+	//  sequence's uniforms on the next submission, so the sequence isn't re-recorded (and earlier submissions aren't waited on).
+	void setUniforms(size_t step, const void* data, size_t size){
+		if(step >= steps.size() || steps[step].type != StepType::Dispatch) assert(0 && "Error: Uniforms can only be set on dispatch steps!");
+		Step& s = steps[step];
+		if(size > s.uniforms.size()) assert(0 && "Error: Data is larger than the shader's uniform block!");
+		memcpy(s.uniforms.data(), data, size);
+		uniformsChanged = true;
+	}
+
+	template<class T>
+	void setUniforms(size_t step, const T& strct){
+		setUniforms(step, &strct, sizeof(T));
+	}
+
+	// Removes every step
+	void clear(){
+		steps.clear();
+		recorded = false;
+	}
+
+	size_t size(){
+		return steps.size();
+	}
+
+
+	/////  Submission  /////
+
+	// Submits the sequence and waits for it to finish
+	void submit(){
+		submitAsync().wait();
+	}
+
+	// Submits the sequence without waiting for it to finish
+	DispatchHandle submitAsync(){
+		if(steps.empty()) return {};
+
+		if(!recorded || descriptorsChanged()) prepare();
+		uint32_t copy = commitUniforms();
+		if(!copyRecorded[copy]) record(copy);
+
+		// Give the buffers used by dispatches a chance to sync any pending changes
+		for(Step& step: steps){
+			for(ComputeBuffer* buffer: step.bound)
+				if(buffer) buffer->prepareForDispatch();
+			for(ComputeBuffer* buffer: step.addressed)
+				buffer->prepareForDispatch();
+			if(step.addressTable && !step.addressTable->isCurrent())
+				assert(0 && "Error: A buffer in the address table has been recreated since its address was stored!");
+		}
+
+		// Wait for any transfers to the buffers used, and mark them as used by this submission
+		uint64_t transferValue = 0, computeValue = context.computeTimeline->upcoming();
+		for(Step& step: steps){
+			for(ComputeBuffer* buffer: step.bound){
+				if(!buffer) continue;
+				transferValue = std::max(transferValue, buffer->lastTransfer);
+				buffer->lastCompute = computeValue;
+				// The barrier at the start of the sequence made any earlier writes visible
+				buffer->lastComputeWrite = 0;
+			}
+			for(Access& access: step.accesses){
+				transferValue = std::max(transferValue, access.buffer->lastTransfer);
+				access.buffer->lastCompute = computeValue;
+				access.buffer->lastComputeWrite = 0;
+			}
+			if(step.shader) step.shader->lastDispatch = computeValue;
+			if(step.descriptor != size_t(-1)) step.shader->descriptorSets[step.descriptor].lastUsed = computeValue;
+		}
+		// Buffers written by the sequence need a barrier before the next dispatch uses them
+		for(Step& step: steps)
+			for(Access& access: step.accesses)
+				if(access.write) access.buffer->lastComputeWrite = computeValue;
+		copyUsed[copy] = lastSubmit = computeValue;
+
+		vk::Semaphore wait = context.transferTimeline->get(), signal = context.computeTimeline->get();
+		vk::PipelineStageFlags waitStage = vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer;
+		uint32_t waitCount = transferValue > 0 ? 1 : 0;
+		vk::TimelineSemaphoreSubmitInfo timelineInfo(waitCount, &transferValue, 1, &computeValue);
+		vk::SubmitInfo si(waitCount, &wait, &waitStage, 1, &cbs[copy], 1, &signal);
+		si.pNext = &timelineInfo;
+		context.computeQueue.submit(si);
+		// Only reserve the value once the submission has been made
+		context.computeTimeline->next();
+
+		context.computeTimeline->poll();
+		return {context.computeTimeline.get(), computeValue};
+	}
+
+protected:
+	size_t addStep(Step& step){
+		steps.push_back(std::move(step));
+		recorded = false;
+		return steps.size() - 1;
+	}
+
+	// Returns true if any dispatch's buffers were recreated, or its descriptor set rewritten, since the sequence was recorded
+	bool descriptorsChanged(){
+		for(Step& step: steps){
+			if(step.type != StepType::Dispatch) continue;
+
+			for(size_t i = 0; i < step.bound.size(); i++)
+				if(step.bound[i] && step.bound[i]->id != step.boundIds[i]) return true;
+			if(step.descriptor != size_t(-1) && step.shader->descriptorSets[step.descriptor].generation != step.descriptorGeneration) return true;
+		}
+		return false;
+	}
+
+	// Snapshots the buffers bound to a dispatch's shader, and how the shader (according to its reflection) accesses them
+	void captureBindings(Step& step){
+		step.bound = step.shader->boundBuffers();
+		step.owners = step.shader->boundOwners();
+		step.boundIds.assign(step.bound.size(), 0);
+		step.accesses.clear();
+		const SpirvReflection& reflection = step.shader->reflection;
+		for(size_t i = 0; i < step.bound.size(); i++){
+			ComputeBuffer* buffer = step.bound[i];
+			if(!buffer) continue;
+
+			// Buffers the shader never touches don't need to be synchronized
+			uint32_t bindPoint = step.shader->descriptorBindings[i];
+			bool reads = reflection.reads(bindPoint), writes = reflection.writes(bindPoint);
+			if(reads || writes) step.accesses.push_back( {buffer, reads, writes} );
+		}
+
+		// Buffers reached through device addresses might be used in any way
+		step.shader->syncAddressTable();
+		step.addressed = step.shader->addressed;
+		step.addressTable = step.shader->addressTable;
+		for(ComputeBuffer* buffer: step.addressed)
+			step.accesses.push_back( {buffer, true, true} );
+	}
+
+	// Works out the descriptor sets and uniform offsets of the steps, discarding the recordings made with the old ones
+	void prepare(){
+		// The recordings might still be executing
+		context.computeTimeline->wait(lastSubmit);
+		for(uint32_t copy = 0; copy < uniformCopies; copy++)
+			if(copyRecorded[copy]){
+				cbs[copy].reset({});
+				copyRecorded[copy] = false;
+			}
+
+		for(Step& step: steps){
+			if(step.type != StepType::Dispatch) continue;
+			if(!step.shader->pipeline) step.shader->finalizePipeline();
+			if(step.pushConstants.size() > step.shader->pushConstants.size())
+				assert(0 && "Error: Push constants are larger than the shader's pipeline was created with!");
+
+			// Find (or write) the descriptor set referring to the step's buffers (unless they are pushed)
+			//  NOTE: A sequence can't use more combinations of a shader's buffers than the shader caches sets for
+			step.boundIds = step.shader->boundIds(step.bound);
+			step.descriptor = step.shader->usePushDescriptors ? -1 : step.shader->acquireDescriptorSet(step.bound);
+			if(step.descriptor != size_t(-1)) step.descriptorGeneration = step.shader->descriptorSets[step.descriptor].generation;
+		}
+		layoutUniforms();
+		recorded = true;
+	}
+
+	// Records the sequence into the command buffer binding the given copy of the uniforms
+	void record(uint32_t copy){
+		vk::CommandBuffer cb = cbs[copy];
+		// The previous recording might still be executing (beginning the command buffer again resets it)
+		context.computeTimeline->wait(copyUsed[copy]);
+		std::map<ComputeBuffer*, BufferState> states;
+		std::vector<vk::BufferMemoryBarrier> barriers;
+
+		cb.begin( {vk::CommandBufferUsageFlagBits::eSimultaneousUse, nullptr} ); {
+			// Make sure any (asynchronous) uploads, and earlier dispatches, have finished writing before the sequence starts
+			vk::MemoryBarrier barrier(vk::AccessFlagBits::eTransferWrite | vk::AccessFlagBits::eShaderWrite,
+				vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite);
+			cb.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eComputeShader,
+				vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eComputeShader, {}, barrier, nullptr, nullptr);
+
+			for(Step& step: steps){
+				vk::PipelineStageFlags stage = step.type == StepType::Dispatch ? vk::PipelineStageFlags(vk::PipelineStageFlagBits::eComputeShader) : vk::PipelineStageFlags(vk::PipelineStageFlagBits::eTransfer);
+				vk::AccessFlags readAccess = step.type == StepType::Dispatch ? vk::AccessFlags(vk::AccessFlagBits::eShaderRead) : vk::AccessFlags(vk::AccessFlagBits::eTransferRead);
+				vk::AccessFlags writeAccess = step.type == StepType::Dispatch ? vk::AccessFlags(vk::AccessFlagBits::eShaderWrite) : vk::AccessFlags(vk::AccessFlagBits::eTransferWrite);
+
+				// Work out which earlier steps this one has to wait for
+				vk::PipelineStageFlags srcStages;
+				barriers.clear();
+				for(Access& access: step.accesses){
+					BufferState& state = states[access.buffer];
+					bool unsynchronized = state.writeStage && (access.write || !(state.visibleStages & stage));
+					if(unsynchronized){
+						// Read/write after write: the earlier write must be made visible
+						srcStages |= state.writeStage;
+						vk::AccessFlags dstAccess = (access.read ? readAccess : vk::AccessFlags()) | (access.write ? writeAccess : vk::AccessFlags());
+						barriers.emplace_back(state.writeAccess, dstAccess, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, access.buffer->buffer, 0, VK_WHOLE_SIZE);
+						state.visibleStages |= stage;
+					}
+					// Write after read: the earlier reads only need to have finished
+					if(access.write && state.readStages) srcStages |= state.readStages;
+				}
+				if(srcStages) cb.pipelineBarrier(srcStages, stage, {}, nullptr, barriers, nullptr);
+
+				// Update what has happened to each buffer
+				for(Access& access: step.accesses){
+					BufferState& state = states[access.buffer];
+					if(access.write) state = {stage, writeAccess, {}, {}};
+					else state.readStages |= stage;
+				}
+
+				recordStep(cb, step, copy);
+			}
+
+			// Make writes to host visible buffers visible to the host once the sequence completes
+			vk::PipelineStageFlags hostSrcStages;
+			vk::AccessFlags hostSrcAccess;
+			for(auto& state: states)
+				if(state.second.writeStage && state.first->isHostVisible()){
+					hostSrcStages |= state.second.writeStage;
+					hostSrcAccess |= state.second.writeAccess;
+				}
+			if(hostSrcStages){
+				vk::MemoryBarrier hostBarrier(hostSrcAccess, vk::AccessFlagBits::eHostRead | vk::AccessFlagBits::eHostWrite);
+				cb.pipelineBarrier(hostSrcStages, vk::PipelineStageFlagBits::eHost, {}, hostBarrier, nullptr, nullptr);
+			}
+		} cb.end();
+
+		copyRecorded[copy] = true;
+	}
+
+	// Lays out the uniform block of each dispatch within a copy of the sequence's uniforms, and writes a set for each
+	//  shader binding the buffer (each dispatch picks its block, in the submitted copy, with a dynamic offset)
+	void layoutUniforms(){
+		vk::DeviceSize alignment = std::max<vk::DeviceSize>(context.deviceProperties.limits.minUniformBufferOffsetAlignment, 4), size = 0;
+		std::map<ComputeShader*, vk::DeviceSize> shaders;	// Shaders with uniform blocks -> size of their block
+		for(Step& step: steps){
+			if(step.type != StepType::Dispatch || step.uniforms.empty()) continue;
+			step.uniformOffset = size;
+			size += (step.uniforms.size() + alignment - 1) / alignment * alignment;
+			shaders[step.shader] = step.uniforms.size();
+		}
+
+		uniformSets.clear();
+		uniformPool.reset();
+		uniformStride = size;
+		uniformsChanged = true;
+		if(!size) return;
+		if(!uniformBuffer || uniformBuffer->bufferSize < size * uniformCopies)
+			uniformBuffer.reset(new ComputeBuffer(context, 0, size * uniformCopies, vk::BufferUsageFlagBits::eUniformBuffer, ComputeBuffer::Residency::HostVisible));
+
+		vk::DescriptorPoolSize poolSize(vk::DescriptorType::eUniformBufferDynamic, (uint32_t) shaders.size());
+		uniformPool = context.device->createDescriptorPoolUnique( {{}, (uint32_t) shaders.size(), poolSize} );
+		for(auto& shader: shaders){
+			vk::DescriptorSet set = context.device->allocateDescriptorSets( {uniformPool.get(), 1, &shader.first->uniformSetLayout.get()} )[0];
+			vk::DescriptorBufferInfo buffInfo(uniformBuffer->buffer, 0, shader.second);
+			vk::WriteDescriptorSet write(set, shader.first->reflection.getUniformBlock()->binding, /*dstArrayElement*/ 0, 1, vk::DescriptorType::eUniformBufferDynamic, /*image*/ nullptr, &buffInfo, /*texelBuffer*/ nullptr);
+			context.device->updateDescriptorSets(write, /*copies*/ {});
+			uniformSets[shader.first] = set;
+		}
+	}
+
+	// Returns the copy of the uniforms holding the current values, moving on to the next copy (and writing the values
+	//  into it) if they, or the push constants, have changed since the last submission
+	uint32_t commitUniforms(){
+		if(uniformsChanged){
+			uniformCopy = (uniformCopy + 1) % uniformCopies;
+			// The copy might still be read by an earlier submission
+			context.computeTimeline->wait(copyUsed[uniformCopy]);
+			uniformsChanged = false;
+			if(!uniformStride) return uniformCopy;
+
+			vk::DeviceSize base = uniformCopy * uniformStride;
+			for(Step& step: steps)
+				if(step.type == StepType::Dispatch && !step.uniforms.empty())
+					memcpy(uniformBuffer->memory.mapped + base + step.uniformOffset, step.uniforms.data(), step.uniforms.size());
+			uniformBuffer->flushMapped(base, uniformStride);
+		}
+		return uniformCopy;
+	}
+
+	void recordStep(vk::CommandBuffer cb, Step& step, uint32_t copy){
+		switch(step.type){
+		case StepType::Dispatch: {
+			ComputeShader& shader = *step.shader;
+			cb.bindPipeline(vk::PipelineBindPoint::eCompute, step.pipeline ? step.pipeline : shader.pipeline.get());
+			if(step.descriptor != size_t(-1)) cb.bindDescriptorSets(vk::PipelineBindPoint::eCompute, shader.pipelineLayout.get(), /*firstSet*/ 0, shader.descriptorSets[step.descriptor].set, {});
+			else if(shader.usePushDescriptors) shader.recordPushDescriptors(cb, step.bound);
+			if(!step.uniforms.empty()) cb.bindDescriptorSets(vk::PipelineBindPoint::eCompute, shader.pipelineLayout.get(), /*firstSet*/ 1, uniformSets[&shader], uint32_t(copy * uniformStride + step.uniformOffset));
+			if(!step.pushConstants.empty()) cb.pushConstants(shader.pipelineLayout.get(), vk::ShaderStageFlagBits::eCompute, 0, (uint32_t) step.pushConstants.size(), step.pushConstants.data());
+			shader.recordGroups(cb, step.x, step.y, step.z);
+			break;
+		}
+		case StepType::Copy:
+			step.dst->recordCopyFrom(cb, *step.src, step.srcOffset, step.dstOffset, step.size);
+			break;
+		case StepType::Fill:
+			step.dst->recordFill(cb, step.value, step.dstOffset, step.size);
+			break;
+		}
+	}
+};
+
+#endif // __COMPUTE_SEQUENCE_VULK_H__
@@ -1,10 +1,18 @@
 #ifndef __COMPUTE_SHADER_VULK_H__
 #define __COMPUTE_SHADER_VULK_H__
 #include "ComputeBuffer.hpp"
+#include "ComputeBufferPool.hpp"
+#include "SpirvReflection.hpp"
+#include "DeviceAddressTable.hpp"
 
 #include <unordered_map>
+#include <map>
 #include <iostream>
 #include <fstream>
+#include <chrono>
+#include <memory>
+#include <algorithm>
+#include <type_traits>
 
 #include <glslang/Public/ShaderLang.h>
 #include <glslang/SPIRV/GlslangToSpv.h>
@@ -13,24 +21,152 @@
 template<typename T>
 struct identity { typedef T type; };
 
+// Handle to a dispatch which may still be running on the GPU
+class DispatchHandle {
+	Timeline* timeline = nullptr;
+	uint64_t value = 0;		// Compute timeline value signaled when the dispatch finishes
+
+public:
+	// Default constructed handles refer to dispatches which have already finished
+	DispatchHandle() = default;
+	DispatchHandle(Timeline* _timeline, uint64_t _value) : timeline(_timeline), value(_value) {}
+
+	// Blocks until the dispatch has finished
+	void wait(){
+		if(timeline) timeline->wait(value);
+	}
+
+	// Returns true if the dispatch has finished
+	bool ready(){
+		return !timeline || timeline->reached(value);
+	}
+
+	// Calls <callback> once the dispatch has finished (see Timeline::then for when it is run)
+	void then(std::function<void()> callback){
+		if(timeline) timeline->then(value, std::move(callback));
+		else callback();
+	}
+};
+
+class ComputeSequence;
+class ShaderCompiler;
+
 class ComputeShader {
+friend class ComputeSequence;
+friend class ShaderCompiler;
 protected:
 	VulkanContext& context;
 
 	vk::UniqueShaderModule program;
+	std::vector<uint32_t> spirv;		// The program's SPIR-V
+	SpirvReflection reflection;			// How the program uses each of its bindings
 	vk::UniqueDescriptorSetLayout descriptorSetLayout;
 	vk::UniqueDescriptorPool descriptorPool;
-	vk::DescriptorSet descriptorSet;
+	std::vector<uint32_t> descriptorBindings;	// Binding points the shader declares (the bindings of the descriptor set layout)
+	bool usePushDescriptors = false;			// Whether buffers are pushed into command buffers instead of using cached descriptor sets
 	vk::UniquePipelineLayout pipelineLayout;
 	vk::UniquePipeline pipeline;
 
+public:
+	// Values for the shader's specialization constants (layout(constant_id = id)), as id -> value (the bits of the
+	//  value are passed through, so floats should be bit cast)
+	using SpecializationConstants = std::map<uint32_t, uint32_t>;
+
+	// Handle to a specialized version of the shader, which shares the shader's bindings and push constants
+	class Variant {
+		ComputeShader* shader = nullptr;
+		vk::Pipeline pipeline;
+		uint32_t localSizeX = 1;
+
+	public:
+		Variant() = default;
+		Variant(ComputeShader* _shader, vk::Pipeline _pipeline, uint32_t _localSizeX) : shader(_shader), pipeline(_pipeline), localSizeX(_localSizeX) {}
+
+		void dispatch(uint32_t x, uint32_t y = 1, uint32_t z = 1){ dispatchAsync(x, y, z).wait(); }
+		DispatchHandle dispatchAsync(uint32_t x, uint32_t y = 1, uint32_t z = 1){ return shader->submitDispatch(x, y, z, nullptr, 0, pipeline); }
+
+		void dispatchElements(size_t elements){ dispatchElementsAsync(elements).wait(); }
+		DispatchHandle dispatchElementsAsync(size_t elements){ return dispatchAsync(groupsForElements(elements)); }
+		uint32_t groupsForElements(size_t elements){ return ComputeShader::groupsForElements(elements, localSizeX); }
+
+		void dispatchIndirect(ComputeBuffer& args, vk::DeviceSize offset = 0){ dispatchIndirectAsync(args, offset).wait(); }
+		DispatchHandle dispatchIndirectAsync(ComputeBuffer& args, vk::DeviceSize offset = 0){
+			ComputeShader::validateIndirect(args, offset);
+			return shader->submitDispatch(0, 0, 0, &args, offset, pipeline);
+		}
+
+		ComputeShader& getShader() { return *shader; }
+		vk::Pipeline getPipeline() { return pipeline; }
+		uint32_t getLocalSizeX() { return localSizeX; }
+	};
+
+protected:
+	std::map<SpecializationConstants, vk::UniquePipeline> variants;	// Specialized pipelines, by constant values
+
 	std::vector<uint8_t> pushConstants;
+
+	// The uniform parameter block (declared in set 1) lives in a persistently mapped ring of copies, each dispatch binds
+	//  the copy holding the current values with a dynamic offset. Changing the values writes them into the next copy,
+	//  so updating even large parameter blocks is just a memcpy (and a different offset) rather than a transfer.
+	std::vector<uint8_t> uniforms;
+	vk::UniqueDescriptorSetLayout uniformSetLayout;
+	vk::UniqueDescriptorPool uniformPool;
+	vk::DescriptorSet uniformSet;
+	std::unique_ptr<ComputeBuffer> uniformRing;
+	vk::DeviceSize uniformStride = 0;		// Distance between the copies (the block's size rounded up to the offset alignment)
+	uint32_t uniformSlot = 0;				// Copy holding the current values
+	std::vector<uint64_t> uniformSlotUsed;	// Compute timeline value signaled by the last dispatch reading each copy
+	bool uniformsChanged = true;			// Whether the values need to be written into a new copy
+
+	// Recorded dispatches are reused as long as the group count, push constants, and bound buffers stay the same
+	//  (the uniform block's dynamic offset is picked at submit, by choosing the command buffer recorded for the current copy)
+	struct RecordedDispatch {
+		std::vector<vk::CommandBuffer> cbs;	// One per uniform block copy (recorded the first time the copy is used)
+		std::vector<bool> cbRecorded;
+		vk::Pipeline pipeline;
+		uint32_t x, y, z;
+		std::vector<uint8_t> pushConstants;
+		vk::DescriptorSet descriptorSet;
+		std::vector<uint64_t> buffers;	// Ids of the buffers bound when it was recorded
+		vk::Buffer indirect;	// Buffer the group counts are read from (if the dispatch is indirect)
+		vk::DeviceSize indirectOffset;
+		bool barrier;			// Whether the recording waits for earlier dispatches
+		uint64_t lastUsed = 0;
+		uint64_t submitted = 0;	// Compute timeline value signaled by the most recent submission of the recording
+		bool valid = false;		// False once its descriptor set has been rewritten (invalidating the recording)
+	};
+
+	// Descriptor sets are cached by the buffers they refer to, so rebinding buffers between dispatches only costs a
+	//  descriptor update the first time a combination of buffers is used
+	struct CachedDescriptorSet {
+		vk::DescriptorSet set;
+		std::vector<uint64_t> buffers;	// Id of the buffer bound at each of the shader's bindings (0 if nothing is)
+		uint64_t generation = 0;		// Incremented whenever the set is rewritten
+		uint64_t lastUsed = 0;			// Compute timeline value signaled by the most recent submission using the set
+		uint64_t lastAcquired = 0;
+	};
+	std::vector<CachedDescriptorSet> descriptorSets;
+	uint64_t descriptorAcquires = 0;
+	vk::UniqueCommandPool commandPool;		// Pool the recorded dispatches are allocated from
+	std::vector<RecordedDispatch> recorded;
+	uint64_t dispatchCount = 0;
+	uint64_t lastDispatch = 0;	// Compute timeline value signaled by the most recent dispatch
 protected:
 	struct CBWrapper {
 		ComputeBuffer* buffer = nullptr;
-		bool owned = false;
+		// Set if we are responsible for the buffer (holding the buffer itself, or the lease from its pool). Sequences
+		//  share it, so a buffer they were recorded with outlives being replaced here.
+		std::shared_ptr<void> owner;
+
+		// Deletes (or returns to its pool) the buffer once nothing else is using it
+		void release(){
+			owner.reset();
+			buffer = nullptr;
+		}
 	};
 	std::vector<CBWrapper> buffers;
+	std::vector<ComputeBuffer*> addressed;	// Buffers the shader reaches through device addresses
+	DeviceAddressTable* addressTable = nullptr;	// Table the addressed buffers are taken from (if the shader was given one)
 public:
 	ComputeShader(VulkanContext& _context, std::ifstream& shaderFile) : context(_context) {
 		const char END_OF_FILE = 26;
@@ -38,39 +174,92 @@ public:
 		std::string src;
 		getline(shaderFile, src, END_OF_FILE);
 
-		// Create the program
-		program = compileShaderModule(src);
+		createProgram(src);
 	}
 
+	// Creates the shader from GLSL source code (which must begin with "#version 430")
+	ComputeShader(VulkanContext& _context, std::string src) : context(_context) {
+		createProgram(src);
+	}
+
+	// Maximum number of distinct dispatches which are kept recorded
+	static constexpr size_t maxRecordedDispatches = 16;
+	// Maximum number of distinct combinations of bound buffers which are kept in descriptor sets
+	static constexpr uint32_t maxDescriptorSets = 64;
+	// Number of copies of the uniform block in its ring (how many updates can be in flight before waiting on the GPU)
+	static constexpr uint32_t uniformRingSlots = 16;
+
 	~ComputeShader(){
+		// Make sure nothing we own is still in use by the GPU
+		context.computeTimeline->wait(lastDispatch);
 		for(CBWrapper& wrap: buffers)
-			if(wrap.owned)
-				delete wrap.buffer;
+			wrap.release();
 	}
 
+	// Dispatches the shader and waits for it to finish
 	void dispatch(uint32_t x, uint32_t y = 1, uint32_t z = 1){
-		// Make sure the pipeline has been created before we submit the shader
-		if(!pipeline) finalizePipeline();
+		dispatchAsync(x, y, z).wait();
+	}
 
-		// Create a new CommandBuffer (Should the buffer be stored instead of recreated every time?)
-		vk::CommandBuffer cb = context.device->allocateCommandBuffers( {context.commandPool.get(), vk::CommandBufferLevel::ePrimary, 1} )[0];
-		cb.begin( {vk::CommandBufferUsageFlagBits::eOneTimeSubmit, nullptr} ); {
-			// Bind pipeline and buffers
-			cb.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline.get());
-			/*if(!descriptorSets.empty())*/ cb.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayout.get(), /*firstSet*/ 0, descriptorSet, {});
-			if(!pushConstants.empty()) cb.pushConstants(pipelineLayout.get(), vk::ShaderStageFlagBits::eCompute, 0, (uint32_t) pushConstants.size(), pushConstants.data());
+	// Submits the shader without waiting for it to finish. The bound buffers remember the dispatch, so transfers
+	//  to or from them (and releasing them) wait for it to complete.
+	DispatchHandle dispatchAsync(uint32_t x, uint32_t y = 1, uint32_t z = 1){
+		return submitDispatch(x, y, z, nullptr, 0);
+	}
 
-			// Dispatch compute shader
-			cb.dispatch(x, y, z);
-		} cb.end();
+	// Dispatches enough workgroups (of the size the shader declares with local_size_x) for <elements> invocations along x.
+	//  The last workgroup may be partially past the end, so the shader should ignore invocations >= <elements>.
+	//  NOTE: More groups than the device allows in one dispatch are split into several dispatches (see recordGroups),
+	//		where gl_WorkGroupID (and gl_GlobalInvocationID) still count from the start but gl_NumWorkGroups only covers
+	//		the current piece, so shaders which read gl_NumWorkGroups can't be split (and assert instead)
+	void dispatchElements(size_t elements){
+		dispatchElementsAsync(elements).wait();
+	}
 
-		// Submit the command buffer
-		context.computeQueue.submit( {{0, nullptr, nullptr, 1, &cb, 0, nullptr}} );
-		// Wait for the command buffer to finish
-		context.computeQueue.waitIdle();
+	DispatchHandle dispatchElementsAsync(size_t elements){
+		return dispatchAsync(groupsForElements(elements));
+	}
+
+	// Number of workgroups along x needed for <elements> invocations
+	uint32_t groupsForElements(size_t elements){
+		return groupsForElements(elements, reflection.getLocalSizeX());
+	}
+
+	// Dispatches the shader with the group counts read (on the GPU) from <args> at <offset>, which should contain
+	//  three uint32_ts (x, y, z) as written by a previous dispatch or transfer
+	void dispatchIndirect(ComputeBuffer& args, vk::DeviceSize offset = 0){
+		dispatchIndirectAsync(args, offset).wait();
+	}
+
+	DispatchHandle dispatchIndirectAsync(ComputeBuffer& args, vk::DeviceSize offset = 0){
+		validateIndirect(args, offset);
+		return submitDispatch(0, 0, 0, &args, offset);
+	}
+
+
+	/////  Specialization  /////
+
+	// Returns a version of the shader with its specialization constants set to the given values, for example:
+	//		auto wide = shader.specialize({ {0, 256}, {1, 4} });
+	//		wide.dispatchElements(n);
+	//  Each set of values is only built into a pipeline the first time it is requested.
+	//  NOTE: The shader's push constants must be set before specializing it
+	Variant specialize(const SpecializationConstants& constants){
+		if(!pipeline) finalizePipeline();
+
+		auto found = variants.find(constants);
+		if(found == variants.end()){
+			std::vector<vk::SpecializationMapEntry> entries;
+			std::vector<uint32_t> data;
+			for(auto& constant: constants){
+				entries.emplace_back(constant.first, uint32_t(data.size() * sizeof(uint32_t)), sizeof(uint32_t));
+				data.push_back(constant.second);
+			}
+			vk::SpecializationInfo info((uint32_t) entries.size(), entries.data(), data.size() * sizeof(uint32_t), data.data());
+			found = variants.emplace(constants, createPipeline(&info)).first;
+		}
 
-		// Release resources
-		context.device->freeCommandBuffers(context.commandPool.get(), cb);
+		return Variant(this, found->second.get(), reflection.getLocalSize(0, constants));
 	}
 
 
@@ -79,7 +268,7 @@ public:
 	ComputeBuffer& createComputeBuffer(vk::DeviceSize size){
 		CBWrapper _new;
 		_new.buffer = new ComputeBuffer(context, buffers.size() + 1, size);
-		_new.owned = true;
+		_new.owner = std::shared_ptr<ComputeBuffer>(_new.buffer);
 		buffers.push_back(_new);
 
 		return *_new.buffer;
@@ -91,36 +280,53 @@ public:
 
 		// Delete the old buffer if it exists
 		CBWrapper& wrap = buffers[bindPoint];
-		if(wrap.buffer && wrap.owned) delete wrap.buffer;
+		wrap.release();
 
 		// Create the new buffer
 		wrap.buffer = new ComputeBuffer(context, bindPoint, size);
-		wrap.owned = true;
+		wrap.owner = std::shared_ptr<ComputeBuffer>(wrap.buffer);
+
+		return *wrap.buffer;
+	}
+
+	// Creates a temporary buffer leased from the <pool>, which is returned to the pool when the buffer is replaced or released
+	ComputeBuffer& createComputeBuffer(ComputeBufferPool& pool, vk::DeviceSize size, size_t bindPoint){
+		// Make sure the array is big enouph
+		if(bindPoint + 1 > buffers.size()) buffers.resize(bindPoint + 1);
+
+		// Delete the old buffer if it exists
+		CBWrapper& wrap = buffers[bindPoint];
+		wrap.release();
+
+		// Lease the new buffer
+		auto lease = std::make_shared<ComputeBufferPool::Lease>(pool.acquire(size, bindPoint));
+		wrap.buffer = lease->get();
+		wrap.owner = lease;
 
 		return *wrap.buffer;
 	}
 
 	void bindComputeBuffer(ComputeBuffer& _new){
-		size_t bindPoint = _new.getBindingPoint();
+		bindComputeBuffer(_new, _new.getBindingPoint());
+	}
 
+	// Binds the buffer at <bindPoint> (instead of the binding point it was created with)
+	void bindComputeBuffer(ComputeBuffer& _new, size_t bindPoint){
 		// Make sure the array is big enouph
 		if(bindPoint + 1 > buffers.size()) buffers.resize(bindPoint + 1);
 
 		// Delete the old buffer if it exists
 		CBWrapper& wrap = buffers[bindPoint];
-		if(wrap.buffer && wrap.owned) delete wrap.buffer;
+		wrap.release();
 
 		wrap.buffer = &_new;
-		wrap.owned = false;
 	}
 
 	void releaseBuffer(size_t bindPoint) {
 		if (bindPoint > buffers.size()) return;
 
 		CBWrapper& wrap = buffers[bindPoint];
-		if(wrap.buffer && wrap.owned) delete wrap.buffer;
-		wrap.buffer = nullptr;
-		wrap.owned = false;
+		wrap.release();
 
 		// Remove any unessicary buffers from the end of the array
 		while(buffers[buffers.size() - 1].buffer == nullptr)
@@ -128,14 +334,44 @@ public:
 	}
 
 
+	// Tells the shader which buffers it reaches through device addresses (see DeviceAddressTable), reflection can't
+	//  see how they are used so dispatches treat them as both read and written
+	void setAddressedBuffers(std::vector<ComputeBuffer*> _addressed){
+		addressed = _addressed;
+		addressTable = nullptr;
+	}
+
+	// Gives the shader the table it reaches buffers through. The table (and the buffers it currently points to) are
+	//  treated as addressed buffers, and are looked up again on every dispatch so entries changed with set() stay synchronized.
+	//  NOTE: The table must outlive the shader (or be replaced first)
+	void setAddressTable(DeviceAddressTable& table){
+		addressTable = &table;
+		syncAddressTable();
+	}
+
+	// How the shader reads and writes the buffers at each binding point
+	const SpirvReflection& getReflection(){
+		return reflection;
+	}
+
+	// Whether the shader's buffers are bound with push descriptors (decided when the pipeline is created, shaders
+	//  fall back to cached descriptor sets if the device doesn't support them or there are too many bindings)
+	bool usesPushDescriptors(){
+		return usePushDescriptors;
+	}
+
+
 	/////  Push Constants  /////
 
 	void setPushConstants(std::vector<uint8_t> data) {
 		if(data.size() > 128) assert(0 && "Data is too large to fit in the push constant buffer");
+		if(pipeline && data.size() > std::max<size_t>(pushConstants.size(), reflection.getPushConstantSize()))
+			assert(0 && "Error: Push constants are larger than the shader's pipeline was created with!");
 		pushConstants = data;
 
-		// Ensure that the buffer's size is always divisible by 4
+		// Ensure that the buffer's size is always divisible by 4 (and covers the shader's whole block)
 		if(pushConstants.size() % 4 != 0) pushConstants.resize(pushConstants.size() + 4 - pushConstants.size() % 4);
+		if(pushConstants.size() < reflection.getPushConstantSize()) pushConstants.resize(reflection.getPushConstantSize());
 	}
 
 	template<class T>
@@ -160,41 +396,520 @@ public:
 		return out;
 	}
 
+	// Sets the member of the shader's push constant block called <name>, converting the value to the member's type
+	//  (so setPushConstant("shouldFlip", true) writes the 4 byte bool GLSL expects). The value is written in place,
+	//  so updating push constants in a loop doesn't allocate.
+	template<class T>
+	typename std::enable_if<std::is_arithmetic<T>::value>::type setPushConstant(const std::string& name, T value){
+		writeConverted(pushConstants, findPushConstant(name), value);
+	}
+
+	// Sets a vector, matrix, array, or struct member from a value whose bytes match the member's GLSL layout
+	template<class T>
+	typename std::enable_if<!std::is_arithmetic<T>::value>::type setPushConstant(const std::string& name, const T& value){
+		writeMember(pushConstants, findPushConstant(name), value);
+	}
+
+	template<class T>
+	T getPushConstant(const std::string& name){
+		return readConverted<T>(pushConstants, findPushConstant(name));
+	}
+
+	// Sets the member called <name> of the push constant block, or of the uniform block if the push constants don't
+	//  have one, so code setting parameters by name works with both the OpenGL and Vulkan shaders
+	template<class T>
+	void setParameter(const std::string& name, T value){
+		if(!reflection.findPushConstant(name) && reflection.getUniformBlock()) setUniform(name, value);
+		else setPushConstant(name, value);
+	}
+
+	template<class T>
+	T getParameter(const std::string& name){
+		if(!reflection.findPushConstant(name) && reflection.getUniformBlock()) return getUniform<T>(name);
+		return getPushConstant<T>(name);
+	}
+
+
+	/////  Uniforms  /////
+
+	// Parameters which don't fit in the 128 bytes of push constants can be declared as a uniform block in set 1:
+	//		layout(std140, set = 1, binding = 0) uniform Params { float weights[64]; uint count; };
+	//  The block is passed to every dispatch, and can be set as a whole (from data matching its std140 layout) or by member.
+
+	void setUniforms(const void* data, size_t size){
+		if(size > uniforms.size()) assert(0 && "Error: Data is larger than the shader's uniform block!");
+		memcpy(uniforms.data(), data, size);
+		uniformsChanged = true;
+	}
+
+	void setUniforms(const std::vector<uint8_t>& data){
+		setUniforms(data.data(), data.size());
+	}
+
+	template<class T>
+	void setUniforms(const T& strct){
+		setUniforms(&strct, sizeof(T));
+	}
+
+	const std::vector<uint8_t>& getUniforms(){
+		return uniforms;
+	}
+
+	// Sets the member of the uniform block called <name>, converting the value to the member's type (like setPushConstant)
+	template<class T>
+	typename std::enable_if<std::is_arithmetic<T>::value>::type setUniform(const std::string& name, T value){
+		writeConverted(uniforms, findUniform(name), value);
+		uniformsChanged = true;
+	}
+
+	template<class T>
+	typename std::enable_if<!std::is_arithmetic<T>::value>::type setUniform(const std::string& name, const T& value){
+		writeMember(uniforms, findUniform(name), value);
+		uniformsChanged = true;
+	}
+
+	template<class T>
+	T getUniform(const std::string& name){
+		return readConverted<T>(uniforms, findUniform(name));
+	}
+
 private:
+	const SpirvReflection::PushConstant& findPushConstant(const std::string& name){
+		const SpirvReflection::PushConstant* member = reflection.findPushConstant(name);
+		if(!member) assert(0 && "Error: The shader's push constant block has no member with that name!");
+		return *member;
+	}
+
+	const SpirvReflection::BlockMember& findUniform(const std::string& name){
+		const SpirvReflection::UniformBlock* block = reflection.getUniformBlock();
+		if(!block) assert(0 && "Error: The shader doesn't declare a uniform block!");
+		const SpirvReflection::BlockMember* member = block->find(name);
+		if(!member) assert(0 && "Error: The shader's uniform block has no member with that name!");
+		return *member;
+	}
+
+	template<class T>
+	static void writeMember(std::vector<uint8_t>& block, const SpirvReflection::BlockMember& member, const T& value){
+		if(sizeof(T) > member.size) assert(0 && "Error: Value is larger than the block member!");
+		if(block.size() < member.offset + sizeof(T)) block.resize(member.offset + sizeof(T));
+		memcpy(block.data() + member.offset, &value, sizeof(T));
+	}
+
+	template<class T>
+	static T readMember(const std::vector<uint8_t>& block, const SpirvReflection::BlockMember& member){
+		T out{};
+		if(member.offset + sizeof(T) <= block.size()) memcpy(&out, block.data() + member.offset, std::min<size_t>(sizeof(T), member.size));
+		return out;
+	}
+
+	// Writes a scalar converted to the member's component type
+	template<class T>
+	static void writeConverted(std::vector<uint8_t>& block, const SpirvReflection::BlockMember& member, T value){
+		switch(member.type){
+		case SpirvReflection::BlockMember::Type::Int: writeMember(block, member, int32_t(value)); break;
+		case SpirvReflection::BlockMember::Type::UInt: writeMember(block, member, uint32_t(value)); break;
+		case SpirvReflection::BlockMember::Type::Float: writeMember(block, member, float(value)); break;
+		default: writeMember(block, member, value);
+		}
+	}
+
+	template<class T>
+	static T readConverted(const std::vector<uint8_t>& block, const SpirvReflection::BlockMember& member){
+		switch(member.type){
+		case SpirvReflection::BlockMember::Type::Int: return T(readMember<int32_t>(block, member));
+		case SpirvReflection::BlockMember::Type::UInt: return T(readMember<uint32_t>(block, member));
+		case SpirvReflection::BlockMember::Type::Float: return T(readMember<float>(block, member));
+		default: return readMember<T>(block, member);
+		}
+	}
+
+	// Returns the copy of the uniform block holding the current values, writing them into the next copy in the ring if
+	//  they have changed since the last dispatch
+	uint32_t commitUniforms(){
+		if(uniformsChanged){
+			uniformSlot = (uniformSlot + 1) % uniformRingSlots;
+			// The copy might still be read by an earlier dispatch
+			context.computeTimeline->wait(uniformSlotUsed[uniformSlot]);
+			memcpy(uniformRing->memory.mapped + uniformSlot * uniformStride, uniforms.data(), uniforms.size());
+			uniformRing->flushMapped(uniformSlot * uniformStride, uniforms.size());
+			uniformsChanged = false;
+		}
+		return uniformSlot;
+	}
+
+	static uint32_t groupsForElements(size_t elements, uint32_t localSize){
+		uint64_t groups = (elements + localSize - 1) / localSize;
+		if(groups > UINT32_MAX) assert(0 && "Error: Too many elements for a single dispatch!");
+		return groups;
+	}
+
+	static void validateIndirect(ComputeBuffer& args, vk::DeviceSize offset){
+		if(offset % 4) assert(0 && "Error: Indirect dispatch offset must be a multiple of 4!");
+		if(offset + sizeof(vk::DispatchIndirectCommand) > args.bufferSize) assert(0 && "Error: Indirect dispatch arguments are outside of the buffer!");
+		if(!(args.usage & vk::BufferUsageFlagBits::eIndirectBuffer)) assert(0 && "Error: Buffer wasn't created with indirect usage!");
+	}
+
+	// Records (or reuses) and submits a dispatch, reading the group counts from <indirect> if it isn't null, using the
+	//  given specialized pipeline (or the unspecialized one if it is null)
+	DispatchHandle submitDispatch(uint32_t x, uint32_t y, uint32_t z, ComputeBuffer* indirect, vk::DeviceSize indirectOffset, vk::Pipeline variant = {}){
+		// Make sure the pipeline has been created before we submit the shader
+		if(!pipeline) finalizePipeline();
+		if(!variant) variant = pipeline.get();
+		// Find (or write) the descriptor set referring to the bound buffers (push descriptors are written into the recording instead)
+		std::vector<ComputeBuffer*> bound = boundBuffers();
+		size_t descriptor = usePushDescriptors ? -1 : acquireDescriptorSet(bound);
+		vk::DescriptorSet set = descriptor == size_t(-1) ? vk::DescriptorSet() : descriptorSets[descriptor].set;
+		uint32_t uniformCopy = uniformSet ? commitUniforms() : 0;
+		syncAddressTable();
+		// Give the buffers a chance to sync any pending changes
+		for(CBWrapper& wrap: buffers)
+			if(wrap.buffer) wrap.buffer->prepareForDispatch();
+		for(ComputeBuffer* buffer: addressed)
+			buffer->prepareForDispatch();
+
+		// Only wait for earlier dispatches if they write a buffer we use, or might still be reading a buffer we write
+		bool barrier = indirect && indirect->lastComputeWrite;
+		for(uint32_t bindPoint = 0; bindPoint < buffers.size(); bindPoint++){
+			ComputeBuffer* buffer = buffers[bindPoint].buffer;
+			if(!buffer) continue;
+			bool reads = reflection.reads(bindPoint), writes = reflection.writes(bindPoint);
+			if((reads || writes) && buffer->lastComputeWrite) barrier = true;
+			if(writes && !context.computeTimeline->reached(buffer->lastCompute)) barrier = true;
+		}
+		for(ComputeBuffer* buffer: addressed)
+			if(buffer->lastComputeWrite || !context.computeTimeline->reached(buffer->lastCompute)) barrier = true;
+
+		// Reuse the recording of this dispatch (recording it if it hasn't been seen before)
+		RecordedDispatch& recording = recordedDispatch(variant, set, bound, x, y, z, indirect, indirectOffset, barrier);
+		vk::CommandBuffer cb = recordedCopy(recording, bound, uniformCopy);
+
+		// Wait for any transfers to the bound buffers, and mark them as used by this dispatch
+		uint64_t transferValue = 0, computeValue = context.computeTimeline->upcoming();
+		recording.submitted = lastDispatch = computeValue;
+		if(descriptor != size_t(-1)) descriptorSets[descriptor].lastUsed = computeValue;
+		if(uniformSet) uniformSlotUsed[uniformSlot] = computeValue;
+		for(uint32_t bindPoint = 0; bindPoint < buffers.size(); bindPoint++){
+			ComputeBuffer* buffer = buffers[bindPoint].buffer;
+			if(!buffer) continue;
+			transferValue = std::max(transferValue, buffer->lastTransfer);
+			buffer->lastCompute = computeValue;
+			// A barrier makes every earlier write visible, otherwise earlier writes are still outstanding
+			if(reflection.writes(bindPoint)) buffer->lastComputeWrite = computeValue;
+			else if(barrier) buffer->lastComputeWrite = 0;
+		}
+		if(indirect){
+			transferValue = std::max(transferValue, indirect->lastTransfer);
+			indirect->lastCompute = computeValue;
+			if(barrier && indirect->lastComputeWrite != computeValue) indirect->lastComputeWrite = 0;
+		}
+		for(ComputeBuffer* buffer: addressed){
+			transferValue = std::max(transferValue, buffer->lastTransfer);
+			buffer->lastCompute = buffer->lastComputeWrite = computeValue;
+		}
+
+		// Submit the command buffer
+		vk::Semaphore wait = context.transferTimeline->get(), signal = context.computeTimeline->get();
+		vk::PipelineStageFlags waitStage = vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eDrawIndirect;
+		uint32_t waitCount = transferValue > 0 ? 1 : 0;
+		vk::TimelineSemaphoreSubmitInfo timelineInfo(waitCount, &transferValue, 1, &computeValue);
+		vk::SubmitInfo si(waitCount, &wait, &waitStage, 1, &cb, 1, &signal);
+		si.pNext = &timelineInfo;
+		context.computeQueue.submit(si);
+		// Only reserve the value once the submission has been made
+		context.computeTimeline->next();
+
+		// Give any callbacks waiting on earlier dispatches a chance to run
+		context.computeTimeline->poll();
+		return {context.computeTimeline.get(), computeValue};
+	}
+
+	// Records a dispatch of the given group counts, splitting the x dimension into several dispatchBase calls (each
+	//  offsetting gl_WorkGroupID) if it is larger than the device allows in a single dispatch. Only x is split, y and z
+	//  must fit the device's limits.
+	void recordGroups(vk::CommandBuffer cb, uint32_t x, uint32_t y, uint32_t z){
+		const uint32_t* maxCount = context.deviceProperties.limits.maxComputeWorkGroupCount;
+		if(y > maxCount[1] || z > maxCount[2]) assert(0 && "Error: Group count is larger than the device supports!");
+
+		if(x <= maxCount[0]){
+			cb.dispatch(x, y, z);
+			return;
+		}
+		// Each piece would see its own group count in gl_NumWorkGroups rather than the total
+		if(reflection.usesNumWorkgroups()) assert(0 && "Error: Shaders reading gl_NumWorkGroups can't be split into several dispatches!");
+		for(uint32_t base = 0; base < x; base += std::min(x - base, maxCount[0]))
+			cb.dispatchBase(base, 0, 0, std::min(x - base, maxCount[0]), y, z);
+	}
+
+	// Finds the recording of a dispatch with the given group count, buffers (and descriptor set), and the current push
+	//  constants, reusing the least recently used recording once the cache is full (its command buffers are recorded by recordedCopy)
+	RecordedDispatch& recordedDispatch(vk::Pipeline variant, vk::DescriptorSet set, const std::vector<ComputeBuffer*>& bound, uint32_t x, uint32_t y, uint32_t z, ComputeBuffer* indirect, vk::DeviceSize indirectOffset, bool barrier){
+		vk::Buffer indirectBuffer = indirect ? indirect->buffer : vk::Buffer();
+		std::vector<uint64_t> ids = boundIds(bound);
+		dispatchCount++;
+		RecordedDispatch* slot = nullptr;
+		for(RecordedDispatch& r: recorded){
+			if(r.valid && r.pipeline == variant && r.descriptorSet == set && r.buffers == ids && r.x == x && r.y == y && r.z == z && r.indirect == indirectBuffer && r.indirectOffset == indirectOffset
+			  && r.barrier == barrier && r.pushConstants == pushConstants){
+				r.lastUsed = dispatchCount;
+				return r;
+			}
+			// Prefer reusing invalidated recordings, then the least recently used one
+			if(!slot || (slot->valid && (!r.valid || r.lastUsed < slot->lastUsed))) slot = &r;
+		}
+
+		// Grow the cache if there is still room
+		if(recorded.size() < maxRecordedDispatches){
+			recorded.emplace_back();
+			slot = &recorded.back();
+			uint32_t copies = uniformSet ? uniformRingSlots : 1;
+			slot->cbs = context.device->allocateCommandBuffers( {commandPool.get(), vk::CommandBufferLevel::ePrimary, copies} );
+			slot->cbRecorded.assign(copies, false);
+		} else {
+			// The recording might still be executing
+			context.computeTimeline->wait(slot->submitted);
+			for(size_t copy = 0; copy < slot->cbs.size(); copy++)
+				if(slot->cbRecorded[copy]){
+					slot->cbs[copy].reset({});
+					slot->cbRecorded[copy] = false;
+				}
+		}
+
+		slot->pipeline = variant;
+		slot->descriptorSet = set;
+		slot->buffers = ids;
+		slot->x = x; slot->y = y; slot->z = z;
+		slot->indirect = indirectBuffer;
+		slot->indirectOffset = indirectOffset;
+		slot->barrier = barrier;
+		slot->pushConstants = pushConstants;
+		slot->lastUsed = dispatchCount;
+		slot->valid = true;
+		return *slot;
+	}
+
+	// The command buffer of <recording> binding the given copy of the uniform block, recording it the first time the copy is used
+	vk::CommandBuffer recordedCopy(RecordedDispatch& recording, const std::vector<ComputeBuffer*>& bound, uint32_t copy){
+		vk::CommandBuffer cb = recording.cbs[copy];
+		if(recording.cbRecorded[copy]) return cb;
+
+		// Recordings can be resubmitted while a previous submission is still executing
+		cb.begin( {vk::CommandBufferUsageFlagBits::eSimultaneousUse, nullptr} ); {
+			// Make sure earlier work on the compute queue (dispatches and sequences) has finished with our buffers before
+			//  the shader accesses them (transfers are waited on through the transfer timeline when submitting)
+			if(recording.barrier){
+				vk::MemoryBarrier memoryBarrier(vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eIndirectCommandRead);
+				cb.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eDrawIndirect, {}, memoryBarrier, nullptr, nullptr);
+			}
+
+			// Bind pipeline and buffers
+			cb.bindPipeline(vk::PipelineBindPoint::eCompute, recording.pipeline);
+			if(recording.descriptorSet) cb.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayout.get(), /*firstSet*/ 0, recording.descriptorSet, {});
+			else if(usePushDescriptors) recordPushDescriptors(cb, bound);
+			if(uniformSet) cb.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayout.get(), /*firstSet*/ 1, uniformSet, uint32_t(copy * uniformStride));
+			if(!recording.pushConstants.empty()) cb.pushConstants(pipelineLayout.get(), vk::ShaderStageFlagBits::eCompute, 0, (uint32_t) recording.pushConstants.size(), recording.pushConstants.data());
+
+			// Dispatch compute shader
+			if(recording.indirect) cb.dispatchIndirect(recording.indirect, recording.indirectOffset);
+			else recordGroups(cb, recording.x, recording.y, recording.z);
+
+			// Make writes to host visible buffers visible to the host (waiting on the timeline alone doesn't)
+			if(writesHostVisible(bound)){
+				vk::MemoryBarrier hostBarrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eHostRead | vk::AccessFlagBits::eHostWrite);
+				cb.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eHost, {}, hostBarrier, nullptr, nullptr);
+			}
+		} cb.end();
+		recording.cbRecorded[copy] = true;
+		return cb;
+	}
+
+	// The buffer bound at each of the shader's bindings (null if nothing is bound there)
+	std::vector<ComputeBuffer*> boundBuffers(){
+		std::vector<ComputeBuffer*> out(descriptorBindings.size(), nullptr);
+		for(size_t i = 0; i < descriptorBindings.size(); i++)
+			if(descriptorBindings[i] < buffers.size()) out[i] = buffers[descriptorBindings[i]].buffer;
+		return out;
+	}
+
+	// Takes the addressed buffers from the shader's address table (if it has one), making sure none of the buffers
+	//  it points to have been recreated since their addresses were stored
+	void syncAddressTable(){
+		if(!addressTable) return;
+		if(!addressTable->isCurrent()) assert(0 && "Error: A buffer in the address table has been recreated since its address was stored!");
+		addressed = addressTable->getBuffers();
+		addressed.push_back(addressTable);
+	}
+
+	// Whether the shader writes any host visible buffer in <bound> (or any of its addressed buffers)
+	bool writesHostVisible(const std::vector<ComputeBuffer*>& bound){
+		for(size_t i = 0; i < bound.size(); i++)
+			if(bound[i] && bound[i]->isHostVisible() && reflection.writes(descriptorBindings[i])) return true;
+		for(ComputeBuffer* buffer: addressed)
+			if(buffer->isHostVisible()) return true;
+		return false;
+	}
+
+	// Ownership of the buffers the shader is responsible for at each of its bindings (null if the buffer isn't ours)
+	std::vector<std::shared_ptr<void>> boundOwners(){
+		std::vector<std::shared_ptr<void>> out(descriptorBindings.size());
+		for(size_t i = 0; i < descriptorBindings.size(); i++)
+			if(descriptorBindings[i] < buffers.size()) out[i] = buffers[descriptorBindings[i]].owner;
+		return out;
+	}
+
+	// The id of each bound buffer (0 if nothing is bound), making sure every binding the shader accesses has a buffer
+	std::vector<uint64_t> boundIds(const std::vector<ComputeBuffer*>& bound){
+		std::vector<uint64_t> ids(bound.size());
+		for(size_t i = 0; i < bound.size(); i++){
+			// Bindings the shader never accesses can be left empty
+			if(!bound[i] && (reflection.reads(descriptorBindings[i]) || reflection.writes(descriptorBindings[i])))
+				assert(0 && "Error: No buffer is bound to a binding point the shader uses!");
+			ids[i] = bound[i] ? bound[i]->id : 0;
+		}
+		return ids;
+	}
+
+	// Descriptor writes pointing each of the shader's bindings at the buffer in <bound> (skipping empty bindings) in
+	//  <set> (null when pushing), the writes point into <buffInfo>
+	std::vector<vk::WriteDescriptorSet> descriptorWrites(vk::DescriptorSet set, const std::vector<ComputeBuffer*>& bound, std::vector<vk::DescriptorBufferInfo>& buffInfo){
+		buffInfo.resize(bound.size());
+		std::vector<vk::WriteDescriptorSet> writes;
+		for(size_t i = 0; i < bound.size(); i++){
+			if(!bound[i]) continue;
+			buffInfo[i] = vk::DescriptorBufferInfo(bound[i]->buffer, 0, bound[i]->bufferSize);
+			writes.emplace_back(set, descriptorBindings[i], /*dstArrayElement*/ 0, 1, vk::DescriptorType::eStorageBuffer, /*image*/ nullptr, &buffInfo[i], /*texelBuffer*/ nullptr);
+		}
+		return writes;
+	}
+
+	// Writes the bindings straight into the command buffer (skipping descriptor sets entirely)
+	void recordPushDescriptors(vk::CommandBuffer cb, const std::vector<ComputeBuffer*>& bound){
+		std::vector<vk::DescriptorBufferInfo> buffInfo;
+		std::vector<vk::WriteDescriptorSet> writes = descriptorWrites({}, bound, buffInfo);
+		if(!writes.empty()) cb.pushDescriptorSetKHR(vk::PipelineBindPoint::eCompute, pipelineLayout.get(), /*set*/ 0, writes);
+	}
+
+	// Returns the index of the cached descriptor set referring to <bound> (a buffer for each of descriptorBindings),
+	//  writing a new set if there isn't one yet (rewriting the least recently used set once the pool is full).
+	//  Returns -1 if the shader has no bindings.
+	size_t acquireDescriptorSet(const std::vector<ComputeBuffer*>& bound){
+		if(descriptorBindings.empty()) return -1;
+		std::vector<uint64_t> ids = boundIds(bound);
+
+		descriptorAcquires++;
+		size_t slot = -1;
+		for(size_t i = 0; i < descriptorSets.size(); i++){
+			if(descriptorSets[i].buffers == ids){
+				descriptorSets[i].lastAcquired = descriptorAcquires;
+				return i;
+			}
+			if(slot == size_t(-1) || descriptorSets[i].lastAcquired < descriptorSets[slot].lastAcquired) slot = i;
+		}
+
+		if(descriptorSets.size() < maxDescriptorSets){
+			slot = descriptorSets.size();
+			descriptorSets.emplace_back();
+			descriptorSets[slot].set = context.device->allocateDescriptorSets( {descriptorPool.get(), 1, &descriptorSetLayout.get()} )[0];
+		} else {
+			// The set can't be rewritten while a dispatch using it is executing
+			context.computeTimeline->wait(descriptorSets[slot].lastUsed);
+			// Recordings which bind the set would now use the wrong buffers
+			for(RecordedDispatch& r: recorded)
+				if(r.descriptorSet == descriptorSets[slot].set) r.valid = false;
+		}
+
+		// Point the set's descriptors at the buffers
+		CachedDescriptorSet& cached = descriptorSets[slot];
+		std::vector<vk::DescriptorBufferInfo> buffInfo;
+		context.device->updateDescriptorSets(descriptorWrites(cached.set, bound, buffInfo), /*copies*/ {});
+
+		cached.buffers = ids;
+		cached.generation++;
+		cached.lastAcquired = descriptorAcquires;
+		return slot;
+	}
+
+	void createProgram(std::string& src){
+		// Create the program
+		program = compileShaderModule(src);
+		// Size the push constants for the shader's block up front, so setting them by name never reallocates
+		pushConstants.resize(reflection.getPushConstantSize());
+		if(const SpirvReflection::UniformBlock* block = reflection.getUniformBlock()){
+			if(block->set != 1) assert(0 && "Error: The uniform block must be declared in set 1!");
+			uniforms.resize(block->size);
+		}
+		// The descriptor set layout covers every storage buffer the shader declares, so any of them can be rebound later
+		for(const SpirvReflection::Binding& b: reflection.getBindings())
+			if(b.set == 0) descriptorBindings.push_back(b.binding);
+		std::sort(descriptorBindings.begin(), descriptorBindings.end());
+		// Create the pool recorded dispatches come from (individual command buffers are re-recorded when evicted)
+		commandPool = context.device->createCommandPoolUnique( {vk::CommandPoolCreateFlagBits::eResetCommandBuffer, context.computeQueueIndex} );
+	}
+
 	// Create the Pipeline with all nessicary bindings
 	void finalizePipeline() {
 		// Create the Descriptor Set Layout
 		std::vector<vk::DescriptorSetLayoutBinding> bindings;
-		for(uint32_t bindPoint = 0; bindPoint < buffers.size(); bindPoint++)
-			if(buffers[bindPoint].buffer)
-				bindings.emplace_back(bindPoint, vk::DescriptorType::eStorageBuffer, /*descriptorCount*/ 1, vk::ShaderStageFlagBits::eCompute, nullptr);
-		if(!bindings.empty()){
-			descriptorSetLayout = context.device->createDescriptorSetLayoutUnique( {{}, (uint32_t) bindings.size(), bindings.data()} );
-
-			// Create the Descriptor Pool
-			vk::DescriptorPoolSize size(vk::DescriptorType::eStorageBuffer, /*should just be 1?*/ uint32_t(bindings.size() > 0 ? bindings.size() : 1));
-			descriptorPool = context.device->createDescriptorPoolUnique( {{}, uint32_t(buffers.size() > 0 ? buffers.size() : 1), size} );
-
-			// Create the Descriptor Sets
-			descriptorSet = context.device->allocateDescriptorSets( {descriptorPool.get(), 1, &descriptorSetLayout.get()} )[0];
-			// Bind the buffers we have created to the descriptor sets
-			std::vector<vk::DescriptorBufferInfo> buffInfo(bindings.size());
-			std::vector<vk::WriteDescriptorSet> writes(bindings.size());
-			for(uint32_t i = 0; i < bindings.size(); i++){
-				uint32_t bindPoint = bindings[i].binding;
-				buffInfo[i] = vk::DescriptorBufferInfo(buffers[bindPoint].buffer->buffer, 0, buffers[bindPoint].buffer->bufferSize);
-				writes[i] = vk::WriteDescriptorSet(descriptorSet, bindPoint, /*dstArrayElement*/ 0, 1, vk::DescriptorType::eStorageBuffer, /*image*/ nullptr, &buffInfo[i], /*texelBuffer*/ nullptr);
+		for(uint32_t bindPoint: descriptorBindings)
+			bindings.emplace_back(bindPoint, vk::DescriptorType::eStorageBuffer, /*descriptorCount*/ 1, vk::ShaderStageFlagBits::eCompute, nullptr);
+		// Push the bindings if the device can push them all, otherwise fall back to cached descriptor sets
+		usePushDescriptors = !bindings.empty() && bindings.size() <= context.maxPushDescriptors;
+		// (Set 0 needs a layout, even if it is empty, when the uniform block is in set 1)
+		if(!bindings.empty() || !uniforms.empty()){
+			vk::DescriptorSetLayoutCreateFlags flags = usePushDescriptors ? vk::DescriptorSetLayoutCreateFlagBits::ePushDescriptorKHR : vk::DescriptorSetLayoutCreateFlags();
+			descriptorSetLayout = context.device->createDescriptorSetLayoutUnique( {flags, (uint32_t) bindings.size(), bindings.data()} );
+
+			// Create the Descriptor Pool (the sets themselves are written when a combination of buffers is first dispatched)
+			if(!usePushDescriptors && !bindings.empty()){
+				vk::DescriptorPoolSize size(vk::DescriptorType::eStorageBuffer, uint32_t(bindings.size()) * maxDescriptorSets);
+				descriptorPool = context.device->createDescriptorPoolUnique( {{}, maxDescriptorSets, size} );
 			}
-			context.device->updateDescriptorSets(writes, /*copies*/ {});
 		}
 
+		if(!uniforms.empty()) createUniformRing();
+
 		// Create the pipeline layout
+		std::vector<vk::DescriptorSetLayout> setLayouts;
+		if(descriptorSetLayout) setLayouts.push_back(descriptorSetLayout.get());
+		if(uniformSetLayout) setLayouts.push_back(uniformSetLayout.get());
 		vk::PushConstantRange constantRange(vk::ShaderStageFlagBits::eCompute, /*offset*/ 0, (uint32_t) pushConstants.size());
-		pipelineLayout = context.device->createPipelineLayoutUnique( {{}, uint32_t(bindings.empty() ? 0 : 1), &descriptorSetLayout.get(), uint32_t(pushConstants.empty() ? 0 : 1), &constantRange} );
+		pipelineLayout = context.device->createPipelineLayoutUnique( {{}, (uint32_t) setLayouts.size(), setLayouts.data(), uint32_t(pushConstants.empty() ? 0 : 1), &constantRange} );
 
 		// Create the pipeline
-		vk::PipelineShaderStageCreateInfo stage({}, vk::ShaderStageFlagBits::eCompute, program.get(), "main", nullptr);
-		pipeline = context.device->createComputePipelineUnique(/*cache*/{}, {vk::PipelineCreateFlagBits::eDispatchBase, stage, pipelineLayout.get(), {}, {}}).value;
+		pipeline = createPipeline();
+	}
+
+	// Creates the host visible ring the uniform block is copied into, and the set (a single dynamic uniform buffer) binding it
+	void createUniformRing(){
+		const vk::PhysicalDeviceLimits& limits = context.deviceProperties.limits;
+		if(uniforms.size() > limits.maxUniformBufferRange) assert(0 && "Error: The uniform block is larger than the device supports!");
+		vk::DeviceSize alignment = std::max<vk::DeviceSize>(limits.minUniformBufferOffsetAlignment, 4);
+		uniformStride = (uniforms.size() + alignment - 1) / alignment * alignment;
+		uniformRing.reset(new ComputeBuffer(context, reflection.getUniformBlock()->binding, uniformStride * uniformRingSlots, vk::BufferUsageFlagBits::eUniformBuffer, ComputeBuffer::Residency::HostVisible));
+		uniformSlotUsed.assign(uniformRingSlots, 0);
+		uniformSlot = uniformRingSlots - 1; // So the first dispatch writes the first copy
+		uniformsChanged = true;
+
+		vk::DescriptorSetLayoutBinding binding(reflection.getUniformBlock()->binding, vk::DescriptorType::eUniformBufferDynamic, /*descriptorCount*/ 1, vk::ShaderStageFlagBits::eCompute, nullptr);
+		uniformSetLayout = context.device->createDescriptorSetLayoutUnique( {{}, 1, &binding} );
+		vk::DescriptorPoolSize size(vk::DescriptorType::eUniformBufferDynamic, 1);
+		uniformPool = context.device->createDescriptorPoolUnique( {{}, 1, size} );
+		uniformSet = context.device->allocateDescriptorSets( {uniformPool.get(), 1, &uniformSetLayout.get()} )[0];
+
+		// The descriptor covers a single copy, dispatches pick which one with their dynamic offset
+		vk::DescriptorBufferInfo buffInfo(uniformRing->buffer, 0, uniforms.size());
+		vk::WriteDescriptorSet write(uniformSet, binding.binding, /*dstArrayElement*/ 0, 1, vk::DescriptorType::eUniformBufferDynamic, /*image*/ nullptr, &buffInfo, /*texelBuffer*/ nullptr);
+		context.device->updateDescriptorSets(write, /*copies*/ {});
+	}
+
+	// Creates a pipeline for the program (with the given specialization constants), using the pipeline layout
+	vk::UniquePipeline createPipeline(const vk::SpecializationInfo* specialization = nullptr){
+		vk::PipelineShaderStageCreateInfo stage({}, vk::ShaderStageFlagBits::eCompute, program.get(), "main", specialization);
+
+		// Time the creation so the effect of the cache can be reported
+		auto start = std::chrono::high_resolution_clock::now();
+		vk::UniquePipeline out = context.device->createComputePipelineUnique(context.pipelineCache->get(), {vk::PipelineCreateFlagBits::eDispatchBase, stage, pipelineLayout.get(), {}, {}}).value;
+		context.pipelineCache->recordCreation(std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count());
+		return out;
 	}
 
 	// Compiles the provided GLSL source code into a SPIR-V based vulkan shader module
@@ -307,9 +1022,8 @@ private:
 	    // Specify that we are providing a compute shader
 	    const EShLanguage stage = EShLangCompute;
 
-	    // Initialize glslang if it hasn't been initialized yet
-	    static bool glslangInitalized = false;
-	    if(!glslangInitalized) glslangInitalized = glslang::InitializeProcess();
+	    // Initialize glslang if it hasn't been initialized yet (static initialization is thread safe, so shaders can be compiled concurrently)
+	    static const bool glslangInitalized = glslang::InitializeProcess();
 	    if(!glslangInitalized) throw std::runtime_error("Failed to initialize glslang");
 
 	    // Create the shader
@@ -325,12 +1039,23 @@ private:
 	    DirStackFileIncluder includer; // #include preprocessor
 	    std::string preprocessedCode;
 	    EShMessages messages = (EShMessages) (EShMsgSpvRules | EShMsgVulkanRules);
+	    bool succeeded = true; // Only successful compilations are cached
 	    if(!shader.preprocess(&DefaultTBuiltInResource, /*default version*/ 100, EProfile::ENoProfile, false, false, messages, &preprocessedCode, includer)){
 	        if(sourceCode.size() > 100) { std::cerr << "Preprocessing failed for:\n" << sourceCode.substr(0, 100) << "..." << std::endl; }
 	        else { std::cerr << "Preprocessing failed for:\n"  << sourceCode << std::endl; }
 	        std::cerr << shader.getInfoLog() << std::endl;
 	        std::cerr << shader.getInfoDebugLog() << std::endl;
+	        succeeded = false;
 	    }
+
+	    // The preprocessed code has its #includes resolved and macros expanded, so together with the target environment
+	    //  and compiler version it determines the resulting SPIR-V
+	    std::string cacheKey = preprocessedCode + "\n//" + entryPoint + " vulkan1.2 spv1.5 " + glslang::GetGlslVersionString()
+	        + " " + std::to_string(glslang::GetSpirvGeneratorVersion()) + " " + std::to_string(messages);
+	    std::vector<uint32_t> spirV;
+	    if(succeeded && context.spirvCache->load(cacheKey, spirV))
+	        return createModule(spirV);
+
 	    const char* preprocessedCString = preprocessedCode.c_str();
 	    shader.setStrings(&preprocessedCString, 1);
 
@@ -340,6 +1065,7 @@ private:
 	        else { std::cerr << "GLSL Parsing failed for:\n" << sourceCode << std::endl; }
 	        std::cerr << shader.getInfoLog() << std::endl;
 	        std::cerr << shader.getInfoDebugLog() << std::endl;
+	        succeeded = false;
 	    }
 
 	    // Link the shader into a program
@@ -350,13 +1076,23 @@ private:
 	        else { std::cerr << "Linking failed for:\n" << sourceCode << std::endl; }
 	        std::cerr << program.getInfoLog() << std::endl;
 	        std::cerr << program.getInfoDebugLog() << std::endl;
+	        succeeded = false;
 	    }
 
 	    // Convert the program to SPIR-V
-	    std::vector<uint32_t> spirV;
+	    // Report failures to the caller (ShaderCompiler passes the exception on through the shader's future)
+	    if(!succeeded) throw std::runtime_error("Failed to compile shader");
 	    glslang::GlslangToSpv(*program.getIntermediate(stage), spirV);
+	    context.spirvCache->store(cacheKey, spirV);
+
+		return createModule(spirV);
+	}
+
+	// Creates the shader module for the SPIR-V (and works out how the program uses its buffers)
+	vk::UniqueShaderModule createModule(const std::vector<uint32_t>& spirV){
+		spirv = spirV;
+		reflection = SpirvReflection(spirv);
 
-		// Create Shader Module
 		return context.device->createShaderModuleUnique( {{}, (uint32_t) spirV.size() * sizeof(uint32_t), spirV.data()} );
 	}
 };
@@ -0,0 +1,55 @@
+#ifndef __DEVICE_ADDRESS_TABLE_VULK_H__
+#define __DEVICE_ADDRESS_TABLE_VULK_H__
+#include "ComputeBuffer.hpp"
+
+#include <vector>
+
+// Buffer holding the device addresses of other buffers, so one pipeline can reach any number of buffers without
+//  needing a binding point (or a descriptor update) for each of them. Bind the table like any other buffer (or pass
+//  table.deviceAddress() in a push constant) and follow the pointers in the shader:
+//		#extension GL_EXT_buffer_reference : require
+//		layout(buffer_reference, std430) buffer Values { float values[]; };
+//		layout(std430, binding = 0) readonly buffer Table { Values tables[]; };
+//		... tables[i].values[j] ...
+//  NOTE: Reflection can't see which buffers a shader reaches through addresses, so the shader has to be given the table
+//		(shader.setAddressTable(table)) for its dispatches to be synchronized with the buffers it points to
+class DeviceAddressTable : public ComputeBuffer {
+protected:
+	std::vector<ComputeBuffer*> buffers;	// Buffer each entry points to
+	std::vector<uint64_t> ids;				// Id of each buffer when its address was stored
+
+public:
+	DeviceAddressTable(VulkanContext& c, unsigned int _bindingPoint, const std::vector<ComputeBuffer*>& _buffers)
+	: ComputeBuffer(c, _bindingPoint, std::max<size_t>(_buffers.size(), 1) * sizeof(vk::DeviceAddress)), buffers(_buffers) {
+		std::vector<vk::DeviceAddress> addresses(buffers.size());
+		for(size_t i = 0; i < buffers.size(); i++){
+			addresses[i] = buffers[i]->deviceAddress();
+			ids.push_back(buffers[i]->id);
+		}
+		if(!addresses.empty()) setData(addresses);
+	}
+
+	// Points entry <index> at <buffer>
+	void set(size_t index, ComputeBuffer& buffer){
+		if(index >= buffers.size()) assert(0 && "Error: Address table index out of range!");
+		buffers[index] = &buffer;
+		ids[index] = buffer.id;
+
+		vk::DeviceAddress address = buffer.deviceAddress();
+		setData(&address, index * sizeof(address), (index + 1) * sizeof(address));
+	}
+
+	const std::vector<ComputeBuffer*>& getBuffers() const {
+		return buffers;
+	}
+
+	// Returns false if one of the buffers has been recreated since its address was stored (so the entry points at
+	//  memory which has been freed)
+	bool isCurrent() const {
+		for(size_t i = 0; i < buffers.size(); i++)
+			if(buffers[i]->id != ids[i]) return false;
+		return true;
+	}
+};
+
+#endif // __DEVICE_ADDRESS_TABLE_VULK_H__
@@ -0,0 +1,295 @@
+#ifndef __DEVICE_ALLOCATOR_VULK_H__
+#define __DEVICE_ALLOCATOR_VULK_H__
+
+#include "VulkanWrapper.hpp"
+
+#include <vector>
+#include <cassert>
+#include <algorithm>
+#include <iostream>
+#include <mutex>
+
+// A piece of device memory handed out by the DeviceAllocator
+struct DeviceAllocation {
+	vk::DeviceMemory memory;		// Memory object the allocation lives in (shared with other allocations)
+	vk::DeviceSize offset = 0;		// Offset of the allocation within that memory
+	vk::DeviceSize size = 0;		// Size which was requested
+	uint8_t* mapped = nullptr;		// Host pointer to the start of the allocation (null unless the memory is host visible)
+	uint32_t memoryType = -1;
+	uint32_t block = -1;			// Index of the block the allocation was carved from
+	uint32_t sizeClass = -1;		// Size class of the allocation (-1 if it has a dedicated block)
+
+	explicit operator bool() const { return bool(memory); }
+};
+
+// Allocator which sub-allocates buffers from a small number of large device memory blocks, rather than issuing a
+//  vkAllocateMemory per buffer. Allocations are rounded up to a power of two size class and placed at an offset aligned
+//  to that size (satisfying any alignment up to the class size), freed allocations are kept on per memory type, per
+//  size class free lists for reuse. Allocations too large for the blocks are given a dedicated allocation.
+//  Allocating and freeing are thread safe (shaders can be created on worker threads).
+class DeviceAllocator {
+public:
+	// Information about how the allocator is using device memory
+	struct Stats {
+		uint32_t blockCount = 0;			// Number of shared blocks
+		uint32_t dedicatedCount = 0;		// Number of dedicated allocations
+		uint32_t allocationCount = 0;		// Number of live allocations
+		vk::DeviceSize reservedBytes = 0;	// Bytes of device memory allocated from the driver
+		vk::DeviceSize requestedBytes = 0;	// Bytes requested by live allocations
+		vk::DeviceSize allocatedBytes = 0;	// Bytes occupied by live allocations (after rounding up to their size class)
+		vk::DeviceSize freeListBytes = 0;	// Bytes sitting on the free lists
+		vk::DeviceSize untouchedBytes = 0;	// Bytes at the end of blocks which have never been handed out
+
+		// Fraction of the occupied bytes wasted by rounding allocations up to their size class
+		double internalFragmentation() const { return allocatedBytes ? 1 - double(requestedBytes) / allocatedBytes : 0; }
+		// Fraction of the free bytes which are broken up into free list chunks instead of contiguous untouched space
+		double externalFragmentation() const { return freeListBytes + untouchedBytes ? double(freeListBytes) / (freeListBytes + untouchedBytes) : 0; }
+	};
+
+	// Smallest size class (every allocation is at least this large and this aligned)
+	static constexpr vk::DeviceSize minClassSize = 256;
+
+protected:
+	struct Block {
+		vk::DeviceMemory memory;
+		vk::DeviceSize size = 0;
+		vk::DeviceSize used = 0;		// Bytes at the start of the block which have been carved into chunks
+		uint8_t* mapped = nullptr;
+		uint32_t memoryType = -1;
+		bool dedicated = false;
+	};
+
+	struct Chunk {
+		uint32_t block;
+		vk::DeviceSize offset;
+	};
+
+	// Per memory type state
+	struct TypePool {
+		std::vector<std::vector<Chunk>> freeLists;	// Free chunks indexed by size class
+		std::vector<uint32_t> blocks;				// Shared blocks of this memory type
+	};
+
+	vk::Device device;
+	vk::PhysicalDeviceMemoryProperties properties;
+	vk::DeviceSize blockSize;
+	bool deviceAddress;		// Whether memory is allocated so buffers bound to it can have device addresses
+	uint32_t classCount;
+
+	std::vector<Block> blocks;
+	std::vector<uint32_t> emptyBlocks;	// Indices of released dedicated blocks which can be reused
+	std::vector<TypePool> pools;
+
+	uint32_t allocationCount = 0;
+	vk::DeviceSize requestedBytes = 0, allocatedBytes = 0;
+	mutable std::mutex mutex;
+
+public:
+	DeviceAllocator(vk::PhysicalDevice physicalDevice, vk::Device _device, vk::DeviceSize _blockSize, bool _deviceAddress = false)
+	: device(_device), properties(physicalDevice.getMemoryProperties()), blockSize(_blockSize), deviceAddress(_deviceAddress) {
+		if(blockSize < minClassSize * 4) blockSize = minClassSize * 4;
+
+		// Size classes go from the minimum up to a quarter of the block size, anything larger gets its own block
+		classCount = 1;
+		while((classSize(classCount) << 2) <= blockSize) classCount++;
+
+		pools.resize(properties.memoryTypeCount);
+		for(TypePool& pool: pools)
+			pool.freeLists.resize(classCount);
+	}
+
+	DeviceAllocator(const DeviceAllocator&) = delete;
+	DeviceAllocator& operator=(const DeviceAllocator&) = delete;
+
+	~DeviceAllocator(){
+		for(Block& block: blocks)
+			if(block.memory)
+				device.free(block.memory);
+	}
+
+	// Finds the index of a memory type allowed by <typeBits> which has all of the <required> properties,
+	//  preferring types which also have the <preferred> properties
+	uint32_t findMemoryType(uint32_t typeBits, vk::MemoryPropertyFlags required, vk::MemoryPropertyFlags preferred = {}) const {
+		uint32_t fallback = -1;
+		for (uint32_t k = 0; k < properties.memoryTypeCount; k++) {
+			vk::MemoryPropertyFlags flags = properties.memoryTypes[k].propertyFlags;
+			if(!(typeBits & (1u << k)) || (flags & required) != required) continue;
+
+			if((flags & preferred) == preferred) return k;
+			if(fallback == uint32_t(-1)) fallback = k;
+		}
+		return fallback;
+	}
+
+	vk::MemoryPropertyFlags memoryTypeFlags(uint32_t memoryType) const {
+		return properties.memoryTypes[memoryType].propertyFlags;
+	}
+
+	// Allocates memory satisfying <requirements>, <dedicated> gives the allocation a block of exactly its size (for large
+	//  long lived allocations which would otherwise be rounded up to a size class and claim a whole shared block)
+	DeviceAllocation allocate(const vk::MemoryRequirements& requirements, vk::MemoryPropertyFlags required, vk::MemoryPropertyFlags preferred = {}, bool dedicated = false){
+		uint32_t memoryType = findMemoryType(requirements.memoryTypeBits, required, preferred);
+		if(memoryType == uint32_t(-1)) assert(0 && "Error: No memory type satisfies the allocation's requirements!");
+
+		std::lock_guard<std::mutex> lock(mutex);
+		DeviceAllocation out;
+		out.size = requirements.size;
+		out.memoryType = memoryType;
+
+		// Determine which size class the allocation falls into (it must be at least as large as the required alignment)
+		vk::DeviceSize needed = std::max(requirements.size, requirements.alignment);
+		uint32_t sizeClass = 0;
+		while(sizeClass < classCount && classSize(sizeClass) < needed) sizeClass++;
+
+		// Allocations which are too big to share a block (or asked not to) get their own
+		if(dedicated || sizeClass == classCount){
+			out.block = createBlock(memoryType, requirements.size, true);
+			out.offset = 0;
+		} else {
+			out.sizeClass = sizeClass;
+			Chunk chunk = takeChunk(memoryType, sizeClass);
+			out.block = chunk.block;
+			out.offset = chunk.offset;
+		}
+
+		Block& block = blocks[out.block];
+		out.memory = block.memory;
+		if(block.mapped) out.mapped = block.mapped + out.offset;
+
+		allocationCount++;
+		requestedBytes += out.size;
+		allocatedBytes += allocationSize(out);
+		return out;
+	}
+
+	void free(DeviceAllocation& allocation){
+		if(!allocation) return;
+
+		std::lock_guard<std::mutex> lock(mutex);
+		allocationCount--;
+		requestedBytes -= allocation.size;
+		allocatedBytes -= allocationSize(allocation);
+
+		// Dedicated allocations are given back to the driver
+		if(allocation.sizeClass == uint32_t(-1)){
+			Block& block = blocks[allocation.block];
+			device.free(block.memory);
+			block = Block();
+			emptyBlocks.push_back(allocation.block);
+		// Everything else is put on a free list for reuse
+		} else
+			pools[allocation.memoryType].freeLists[allocation.sizeClass].push_back( {allocation.block, allocation.offset} );
+
+		allocation = DeviceAllocation();
+	}
+
+	Stats getStats() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		Stats out;
+		out.allocationCount = allocationCount;
+		out.requestedBytes = requestedBytes;
+		out.allocatedBytes = allocatedBytes;
+
+		for(const Block& block: blocks){
+			if(!block.memory) continue;
+
+			if(block.dedicated) out.dedicatedCount++;
+			else {
+				out.blockCount++;
+				out.untouchedBytes += block.size - block.used;
+			}
+			out.reservedBytes += block.size;
+		}
+
+		for(const TypePool& pool: pools)
+			for(uint32_t c = 0; c < classCount; c++)
+				out.freeListBytes += pool.freeLists[c].size() * classSize(c);
+
+		return out;
+	}
+
+protected:
+	static vk::DeviceSize classSize(uint32_t sizeClass){
+		return minClassSize << sizeClass;
+	}
+
+	static vk::DeviceSize allocationSize(const DeviceAllocation& allocation){
+		return allocation.sizeClass == uint32_t(-1) ? allocation.size : classSize(allocation.sizeClass);
+	}
+
+	// Finds a free chunk of the given size class, carving a new one out of a block if none are free
+	Chunk takeChunk(uint32_t memoryType, uint32_t sizeClass){
+		TypePool& pool = pools[memoryType];
+		std::vector<Chunk>& freeList = pool.freeLists[sizeClass];
+		if(!freeList.empty()){
+			Chunk out = freeList.back();
+			freeList.pop_back();
+			return out;
+		}
+
+		const vk::DeviceSize size = classSize(sizeClass);
+		// Find a block with enouph untouched space left
+		uint32_t index = -1;
+		for(uint32_t b: pool.blocks){
+			vk::DeviceSize aligned = (blocks[b].used + size - 1) / size * size;
+			if(aligned + size <= blocks[b].size){
+				index = b;
+				break;
+			}
+		}
+		if(index == uint32_t(-1)){
+			index = createBlock(memoryType, blockSize, false);
+			pool.blocks.push_back(index);
+		}
+
+		// Align the chunk to its size, putting the space skipped over on the smaller free lists
+		Block& block = blocks[index];
+		vk::DeviceSize aligned = (block.used + size - 1) / size * size;
+		while(block.used < aligned){
+			uint32_t c = sizeClass;
+			while(c > 0 && (block.used % classSize(c) != 0 || block.used + classSize(c) > aligned)) c--;
+			pool.freeLists[c].push_back( {index, block.used} );
+			block.used += classSize(c);
+		}
+
+		Chunk out = {index, block.used};
+		block.used += size;
+		return out;
+	}
+
+	uint32_t createBlock(uint32_t memoryType, vk::DeviceSize size, bool dedicated){
+		Block block;
+		vk::MemoryAllocateInfo info(size, memoryType);
+		// Buffers can only have device addresses if their memory is allocated with them
+		vk::MemoryAllocateFlagsInfo flags(vk::MemoryAllocateFlagBits::eDeviceAddress);
+		if(deviceAddress) info.pNext = &flags;
+		block.memory = device.allocateMemory(info);
+		block.size = size;
+		block.used = dedicated ? size : 0;
+		block.memoryType = memoryType;
+		block.dedicated = dedicated;
+		// Keep host visible memory permanently mapped
+		if(memoryTypeFlags(memoryType) & vk::MemoryPropertyFlagBits::eHostVisible)
+			block.mapped = (uint8_t*) device.mapMemory(block.memory, 0, VK_WHOLE_SIZE, {});
+
+		if(!emptyBlocks.empty()){
+			uint32_t index = emptyBlocks.back();
+			emptyBlocks.pop_back();
+			blocks[index] = block;
+			return index;
+		}
+		blocks.push_back(block);
+		return blocks.size() - 1;
+	}
+};
+
+inline std::ostream& operator<<(std::ostream& stream, const DeviceAllocator::Stats& stats){
+	stream << "Device memory: " << stats.blockCount << " blocks + " << stats.dedicatedCount << " dedicated ("
+		<< stats.reservedBytes << " bytes reserved), " << stats.allocationCount << " allocations ("
+		<< stats.requestedBytes << " bytes requested, " << stats.allocatedBytes << " bytes occupied), "
+		<< stats.freeListBytes << " bytes on free lists, " << stats.untouchedBytes << " bytes untouched, "
+		<< "fragmentation: " << stats.internalFragmentation() * 100 << "% internal / " << stats.externalFragmentation() * 100 << "% external";
+	return stream;
+}
+
+#endif // __DEVICE_ALLOCATOR_VULK_H__
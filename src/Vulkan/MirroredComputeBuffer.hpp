@@ -0,0 +1,154 @@
+#ifndef __MIRRORED_COMPUTE_BUFFER_VULK_H__
+#define __MIRRORED_COMPUTE_BUFFER_VULK_H__
+
+#include "ComputeBuffer.hpp"
+#include "TransferBatch.hpp"
+
+#include <vector>
+
+// ComputeBuffer which keeps a copy of its contents on the host. Writes to the host copy mark the pages they touch as
+//  dirty, and right before a dispatch uses the buffer only the dirty pages (with adjacent pages coalesced into a single
+//  region) are uploaded.
+class MirroredComputeBuffer: public ComputeBuffer {
+public:
+	// Proxy for an element of the host copy, assigning to it writes through to the copy and marks it dirty
+	template <class T>
+	class Reference {
+		MirroredComputeBuffer* owner;
+		size_t index;
+
+	public:
+		Reference(MirroredComputeBuffer* _owner, size_t _index) : owner(_owner), index(_index) {}
+
+		operator T() const { return owner->read<T>(index); }
+		Reference& operator=(const T& value){
+			owner->write<T>(index, value);
+			return *this;
+		}
+		Reference& operator=(const Reference& o){ return *this = T(o); }
+	};
+
+	// Typed view of the host copy
+	template <class T>
+	class View {
+		MirroredComputeBuffer* owner;
+
+	public:
+		View(MirroredComputeBuffer* _owner) : owner(_owner) {}
+
+		Reference<T> operator[](size_t index) { return Reference<T>(owner, index); }
+		size_t size() const { return owner->shadow.size() / sizeof(T); }
+	};
+
+protected:
+	std::vector<uint8_t> shadow;	// Host copy of the buffer's contents
+	vk::DeviceSize pageSize;		// Granularity (in bytes) dirty ranges are tracked at
+	std::vector<bool> dirty;		// Which pages have been modified since the last upload
+	size_t firstDirty, lastDirty;	// Range of pages which might be dirty (empty if first > last)
+	TransferBatch batch;
+
+public:
+	MirroredComputeBuffer(VulkanContext& c, unsigned int _bindingPoint, vk::DeviceSize size, vk::DeviceSize _pageSize = 4096, Residency _residency = Residency::Automatic)
+	: ComputeBuffer(c, _bindingPoint, _residency), pageSize(_pageSize), batch(c) {
+		bufferSize = size;
+		createBuffer();
+		createShadow();
+		// The GPU's copy starts out matching the (zeroed) host copy
+		markDirty(0, bufferSize);
+	}
+
+	template <class T>
+	MirroredComputeBuffer(VulkanContext& c, unsigned int _bindingPoint, std::vector<T>& data, vk::DeviceSize _pageSize = 4096, Residency _residency = Residency::Automatic)
+	: MirroredComputeBuffer(c, _bindingPoint, data.size() * sizeof(data[0]), _pageSize, _residency) {
+		memcpy(shadow.data(), data.data(), bufferSize);
+	}
+
+	// Direct access to the host copy (call markDirty after modifying it)
+	uint8_t* data() { return shadow.data(); }
+
+	template <class T>
+	View<T> view() { return View<T>(this); }
+
+	template <class T>
+	T read(size_t index){
+		T out;
+		memcpy(&out, shadow.data() + index * sizeof(T), sizeof(T));
+		return out;
+	}
+
+	template <class T>
+	void write(size_t index, const T& value){
+		memcpy(shadow.data() + index * sizeof(T), &value, sizeof(T));
+		markDirty(index * sizeof(T), sizeof(T));
+	}
+
+	// Marks the given range of the host copy as needing to be uploaded
+	void markDirty(vk::DeviceSize offset, vk::DeviceSize size){
+		if(!size) return;
+		if(offset + size > bufferSize) assert(0 && "Error: Dirty range is outside of the buffer!");
+
+		size_t first = offset / pageSize, last = (offset + size - 1) / pageSize;
+		for(size_t page = first; page <= last; page++)
+			dirty[page] = true;
+		firstDirty = std::min(firstDirty, first);
+		lastDirty = std::max(lastDirty, last);
+	}
+
+	// Uploads any dirty pages, returns a handle to the upload
+	TransferHandle flush(){
+		if(firstDirty > lastDirty) return {};
+
+		// Upload each run of dirty pages as a single region
+		for(size_t page = firstDirty; page <= lastDirty; page++){
+			if(!dirty[page]) continue;
+
+			size_t run = page;
+			while(run <= lastDirty && dirty[run]){
+				dirty[run] = false;
+				run++;
+			}
+
+			vk::DeviceSize begin = page * pageSize, end = std::min<vk::DeviceSize>(run * pageSize, bufferSize);
+			batch.upload(*this, shadow.data() + begin, begin, end - begin);
+			page = run;
+		}
+		resetDirtyRange();
+
+		return batch.submitAsync();
+	}
+
+	// Replaces the host copy with the buffer's current contents on the GPU (discarding any pending changes)
+	void pull(){
+		getData(shadow.data());
+		std::fill(dirty.begin(), dirty.end(), false);
+		resetDirtyRange();
+	}
+
+	virtual void release(){
+		shadow.clear();
+		dirty.clear();
+		resetDirtyRange();
+
+		ComputeBuffer::release();
+	}
+
+protected:
+	// Called by ComputeShader::dispatch before it uses the buffer
+	virtual void prepareForDispatch(){
+		flush();
+	}
+
+	void createShadow(){
+		if(!pageSize) pageSize = 1;
+		shadow.assign(bufferSize, 0);
+		dirty.assign((bufferSize + pageSize - 1) / pageSize, false);
+		resetDirtyRange();
+	}
+
+	void resetDirtyRange(){
+		firstDirty = -1;
+		lastDirty = 0;
+	}
+};
+
+#endif // __MIRRORED_COMPUTE_BUFFER_VULK_H__
@@ -0,0 +1,132 @@
+#ifndef __PIPELINE_CACHE_VULK_H__
+#define __PIPELINE_CACHE_VULK_H__
+
+#include "VulkanWrapper.hpp"
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+// Wrapper around a vk::PipelineCache which is loaded from (and saved back to) a file, so pipelines built by one run of
+//  the program don't have to be recompiled by the driver in the next. The file is only used if its header matches the
+//  current device (vendor, device, and pipeline cache UUID, which changes whenever the driver does).
+class PipelineCache {
+public:
+	struct Stats {
+		size_t loadedBytes = 0;			// Size of the cache loaded from disk (0 if there wasn't a valid one)
+		double loadSeconds = 0;
+		uint64_t pipelines = 0;			// Pipelines created using the cache
+		double pipelineSeconds = 0;		// Total time spent creating them
+	};
+
+protected:
+	using Clock = std::chrono::high_resolution_clock;
+
+	// Header at the start of the cache data (see VkPipelineCacheHeaderVersionOne)
+	struct Header {
+		uint32_t length;
+		uint32_t version;
+		uint32_t vendorID;
+		uint32_t deviceID;
+		uint8_t uuid[VK_UUID_SIZE];
+	};
+
+	vk::Device device;
+	vk::PhysicalDeviceProperties properties;
+	std::string path;		// File the cache is stored in (empty if the cache shouldn't be persisted)
+	bool verbose;			// Whether loading and saving the cache is logged
+	vk::PipelineCache cache;	// NOTE: Vulkan synchronizes access to the cache internally, so pipelines can be created concurrently
+	Stats stats;
+	mutable std::mutex statsMutex;
+
+public:
+	PipelineCache(vk::Device _device, const vk::PhysicalDeviceProperties& _properties, std::string _path, bool _verbose = false)
+	: device(_device), properties(_properties), path(_path), verbose(_verbose) {
+		Clock::time_point start = Clock::now();
+
+		std::vector<uint8_t> data;
+		if(!path.empty()) data = load();
+
+		cache = device.createPipelineCache( {{}, data.size(), data.data()} );
+		stats.loadedBytes = data.size();
+		stats.loadSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+		if(verbose && !path.empty()){
+			if(data.empty()) std::cout << "Pipeline cache: no valid cache at '" << path << "', pipelines will be compiled from scratch" << std::endl;
+			else std::cout << "Pipeline cache: loaded " << data.size() << " bytes from '" << path << "' in " << stats.loadSeconds * 1000 << " ms" << std::endl;
+		}
+	}
+
+	PipelineCache(const PipelineCache&) = delete;
+	PipelineCache& operator=(const PipelineCache&) = delete;
+
+	~PipelineCache(){
+		save();
+		device.destroy(cache);
+	}
+
+	vk::PipelineCache get() const { return cache; }
+
+	// Records how long it took to create a pipeline using the cache
+	void recordCreation(double seconds){
+		std::lock_guard<std::mutex> lock(statsMutex);
+		stats.pipelines++;
+		stats.pipelineSeconds += seconds;
+	}
+
+	Stats getStats() const {
+		std::lock_guard<std::mutex> lock(statsMutex);
+		return stats;
+	}
+
+	// Writes the cache to its file (replacing the old file only once the new one has been completely written),
+	//  returns false if it couldn't be written
+	bool save(){
+		if(path.empty()) return false;
+
+		std::vector<uint8_t> data = device.getPipelineCacheData(cache);
+		std::string temp = path + ".tmp";
+		{
+			std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+			if(!file.write((const char*) data.data(), data.size())) return false;
+		}
+		if(std::rename(temp.c_str(), path.c_str())){
+			std::remove(temp.c_str());
+			return false;
+		}
+
+		Stats current = getStats();
+		if(verbose && current.pipelines)
+			std::cout << "Pipeline cache: created " << current.pipelines << " pipelines in " << current.pipelineSeconds * 1000 << " ms ("
+				<< (current.loadedBytes ? "warm" : "cold") << " cache), saved " << data.size() << " bytes to '" << path << "'" << std::endl;
+		return true;
+	}
+
+protected:
+	// Reads the cache file, returning nothing if it doesn't exist or was created by a different device or driver
+	std::vector<uint8_t> load(){
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if(!file) return {};
+
+		std::vector<uint8_t> data((size_t) file.tellg());
+		file.seekg(0);
+		if(!file.read((char*) data.data(), data.size())) return {};
+
+		Header header;
+		if(data.size() < sizeof(Header)) return {};
+		memcpy(&header, data.data(), sizeof(Header));
+		if(header.length < sizeof(Header) || header.version != VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+		  || header.vendorID != properties.vendorID || header.deviceID != properties.deviceID
+		  || memcmp(header.uuid, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+			return {};
+
+		return data;
+	}
+};
+
+#endif // __PIPELINE_CACHE_VULK_H__
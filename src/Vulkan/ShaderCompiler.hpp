@@ -0,0 +1,103 @@
+#ifndef __SHADER_COMPILER_VULK_H__
+#define __SHADER_COMPILER_VULK_H__
+#include "ComputeShader.hpp"
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <memory>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Pool of worker threads which compile shaders and create their pipelines, so loading many shaders scales with the
+//  core count:
+//		ShaderCompiler compiler(context);
+//		auto futures = compiler.compile({ source1, source2 });
+//		std::unique_ptr<ComputeShader> first = futures[0].get();
+//  Destroying the pool finishes any shaders still queued and then joins the workers.
+//  NOTE: The context must outlive the pool
+class ShaderCompiler {
+protected:
+	struct Job {
+		std::string source;
+		std::promise<std::unique_ptr<ComputeShader>> promise;
+	};
+
+	VulkanContext& context;
+	std::vector<std::thread> workers;
+	std::deque<Job> jobs;
+	std::mutex mutex;
+	std::condition_variable available;	// Signaled when a job is queued (or the pool is stopping)
+	bool stopping = false;
+
+public:
+	// Starts <threads> workers (one per core if 0)
+	ShaderCompiler(VulkanContext& _context, unsigned int threads = 0) : context(_context) {
+		if(!threads) threads = std::max(1u, std::thread::hardware_concurrency());
+		for(unsigned int t = 0; t < threads; t++)
+			workers.emplace_back([this]{ work(); });
+	}
+
+	ShaderCompiler(const ShaderCompiler&) = delete;
+	ShaderCompiler& operator=(const ShaderCompiler&) = delete;
+
+	~ShaderCompiler(){
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		available.notify_all();
+		for(std::thread& worker: workers)
+			worker.join();
+	}
+
+	// Queues GLSL <source> to be compiled, the future holds the shader (with its pipeline created, ready to dispatch)
+	//  or the exception thrown while creating it
+	std::future<std::unique_ptr<ComputeShader>> compile(std::string source){
+		Job job;
+		job.source = std::move(source);
+		std::future<std::unique_ptr<ComputeShader>> out = job.promise.get_future();
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			jobs.push_back(std::move(job));
+		}
+		available.notify_one();
+		return out;
+	}
+
+	// Queues each of the sources, the n-th future holds the shader compiled from the n-th source
+	std::vector<std::future<std::unique_ptr<ComputeShader>>> compile(std::vector<std::string> sources){
+		std::vector<std::future<std::unique_ptr<ComputeShader>>> out;
+		for(std::string& source: sources)
+			out.push_back(compile(std::move(source)));
+		return out;
+	}
+
+protected:
+	void work(){
+		while(true){
+			Job job;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				available.wait(lock, [this]{ return stopping || !jobs.empty(); });
+				// Queued shaders are still compiled when stopping, so every future gets a result
+				if(jobs.empty()) return;
+				job = std::move(jobs.front());
+				jobs.pop_front();
+			}
+
+			try {
+				std::unique_ptr<ComputeShader> shader(new ComputeShader(context, job.source));
+				// The layout comes from the shader's reflection, so the pipeline can be created here rather than on first dispatch
+				shader->finalizePipeline();
+				job.promise.set_value(std::move(shader));
+			} catch(...) {
+				job.promise.set_exception(std::current_exception());
+			}
+		}
+	}
+};
+
+#endif // __SHADER_COMPILER_VULK_H__
@@ -0,0 +1,101 @@
+#ifndef __SPIRV_CACHE_VULK_H__
+#define __SPIRV_CACHE_VULK_H__
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Content addressed cache of compiled SPIR-V, stored as one <hash>.spv file per shader in a directory. The key should
+//  cover everything which affects the compiled result (the preprocessed source, target environment, compiler version...).
+//  Files are written to a temporary file and then renamed into place, so several processes can share a directory
+//  without ever reading a partially written module. Each file starts with the full key it was stored under, which is
+//  compared on load, so two keys with the same hash never load each other's module.
+class SpirvCache {
+protected:
+	std::string directory;	// Directory the modules are stored in (empty if caching is disabled)
+	std::atomic<uint32_t> tempCount{0};	// Used to give each temporary file a unique name
+
+	// Files begin with the magic number, the key's length, and then the key (padded to a multiple of 4 bytes)
+	static constexpr uint32_t magic = 0x43565053; // "SPVC"
+
+public:
+	SpirvCache(std::string _directory) : directory(_directory) {
+		if(!directory.empty()) mkdir(directory.c_str(), 0755); // Fails harmlessly if it already exists
+	}
+
+	bool enabled() const { return !directory.empty(); }
+
+	// 64-bit FNV-1a hash of the key
+	static uint64_t hash(const std::string& key){
+		uint64_t h = 14695981039346656037ull;
+		for(unsigned char c: key){
+			h ^= c;
+			h *= 1099511628211ull;
+		}
+		return h;
+	}
+
+	// Loads the module cached for <key> into <spirv>, returns false if there isn't one
+	bool load(const std::string& key, std::vector<uint32_t>& spirv) const {
+		if(!enabled()) return false;
+
+		std::ifstream file(path(key), std::ios::binary | std::ios::ate);
+		if(!file) return false;
+		size_t size = file.tellg();
+		if(size % sizeof(uint32_t)) return false;
+		std::vector<uint32_t> words(size / sizeof(uint32_t));
+		file.seekg(0);
+		if(!file.read((char*) words.data(), size)) return false;
+
+		// Make sure the file was stored under the same key (and not just one with the same hash)
+		if(words.size() < 2 || words[0] != magic || words[1] != key.size()) return false;
+		size_t keyWords = (key.size() + 3) / 4;
+		if(words.size() < 2 + keyWords + 1 || key.compare(0, key.size(), (const char*) &words[2], key.size()) != 0) return false;
+
+		spirv.assign(words.begin() + 2 + keyWords, words.end());
+		if(spirv[0] != 0x07230203){
+			spirv.clear();
+			return false;
+		}
+		return true;
+	}
+
+	// Stores the module compiled for <key>
+	void store(const std::string& key, const std::vector<uint32_t>& spirv){
+		if(!enabled() || spirv.empty()) return;
+
+		std::vector<uint32_t> header(2 + (key.size() + 3) / 4, 0);
+		header[0] = magic;
+		header[1] = uint32_t(key.size());
+		if(!key.empty()) memcpy(&header[2], key.data(), key.size());
+
+		std::string target = path(key);
+		std::string temp = target + ".tmp" + std::to_string(getpid()) + "-" + std::to_string(tempCount++);
+		{
+			std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+			if(!file.write((const char*) header.data(), header.size() * sizeof(uint32_t))
+			  || !file.write((const char*) spirv.data(), spirv.size() * sizeof(uint32_t))){
+				file.close();
+				std::remove(temp.c_str());
+				return;
+			}
+		}
+		if(std::rename(temp.c_str(), target.c_str())) std::remove(temp.c_str());
+	}
+
+protected:
+	std::string path(const std::string& key) const {
+		char name[17];
+		snprintf(name, sizeof(name), "%016llx", (unsigned long long) hash(key));
+		return directory + "/" + name + ".spv";
+	}
+};
+
+#endif // __SPIRV_CACHE_VULK_H__
@@ -0,0 +1,386 @@
+#ifndef __SPIRV_REFLECTION_VULK_H__
+#define __SPIRV_REFLECTION_VULK_H__
+
+#include <vector>
+#include <map>
+#include <string>
+#include <functional>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+
+// Minimal SPIR-V reflection: finds the workgroup size, the members of the push constant and uniform blocks, and the storage buffers
+//  a compute shader declares, and works out which of the buffers the shader actually reads from and writes to. Usage
+//  is determined from the loads, stores, and atomics performed through each buffer (following access chains back to
+//  the buffer's variable), and is then limited by any readonly (NonWritable) / writeonly (NonReadable) qualifiers.
+//  Any other instruction given a pointer into a buffer (extension atomics like OpAtomicFAddEXT for example) is assumed
+//  to both read and write it.
+class SpirvReflection {
+public:
+	struct Binding {
+		uint32_t set = 0, binding = 0;
+		bool reads = false, writes = false;		// Whether the shader accesses the buffer this way
+		bool nonWritable = false, nonReadable = false;	// readonly / writeonly qualifiers
+	};
+
+	// A member of the push constant or uniform block
+	struct BlockMember {
+		enum class Type { Int, UInt, Float, Other };	// Type of the member's components (bools in blocks are uints)
+		std::string name;
+		uint32_t offset = 0, size = 0;		// In bytes
+		Type type = Type::Other;
+		uint32_t components = 1;			// Number of components if the member is a vector
+	};
+	using PushConstant = BlockMember;
+
+	// A uniform block (the first one the shader declares)
+	struct UniformBlock {
+		uint32_t set = 0, binding = 0;
+		uint32_t size = 0;					// In bytes
+		std::vector<BlockMember> members;
+
+		// Returns the member with the given name (nullptr if the block doesn't have one)
+		const BlockMember* find(const std::string& name) const {
+			for(const BlockMember& m: members)
+				if(m.name == name)
+					return &m;
+			return nullptr;
+		}
+	};
+
+protected:
+	// Opcodes and enumerants used (see the SPIR-V specification)
+	enum Op : uint32_t {
+		OpMemberName = 6, OpTypeBool = 20, OpTypeInt = 21, OpTypeFloat = 22, OpTypeVector = 23, OpTypeMatrix = 24, OpTypeArray = 28,
+		OpExecutionMode = 16, OpTypeStruct = 30, OpConstant = 43, OpSpecConstant = 50, OpSpecConstantComposite = 51,
+		OpExecutionModeId = 331, OpTypePointer = 32, OpFunctionCall = 57, OpVariable = 59, OpLoad = 61,
+		OpStore = 62, OpCopyMemory = 63, OpAccessChain = 65, OpInBoundsAccessChain = 66, OpPtrAccessChain = 67,
+		OpDecorate = 71, OpMemberDecorate = 72, OpCopyObject = 83, OpAtomicLoad = 227, OpAtomicStore = 228,
+		OpInBoundsPtrAccessChain = 70,
+		// Instructions which never access memory through their operands (see ignoresPointers)
+		OpExtInst = 12, OpCapability = 17, OpTypeVoid = 19, OpSpecConstantOp = 52, OpFunction = 54, OpFunctionEnd = 56,
+		OpArrayLength = 68, OpGroupMemberDecorate = 75, OpVectorExtractDynamic = 77, OpCompositeInsert = 82, OpLoopMerge = 246,
+		OpSwitch = 251, OpNoLine = 317, OpModuleProcessed = 330, OpDecorateId = 332, OpDecorateString = 5632, OpMemberDecorateString = 5633,
+	};
+	enum Decoration : uint32_t { DecorationSpecId = 1, DecorationBlock = 2, DecorationArrayStride = 6, DecorationMatrixStride = 7, DecorationOffset = 35, DecorationBufferBlock = 3, DecorationBuiltIn = 11, DecorationNonWritable = 24, DecorationNonReadable = 25, DecorationBinding = 33, DecorationDescriptorSet = 34 };
+	enum StorageClass : uint32_t { StorageClassUniform = 2, StorageClassPushConstant = 9, StorageClassStorageBuffer = 12 };
+	enum ExecutionMode : uint32_t { ExecutionModeLocalSize = 17, ExecutionModeLocalSizeId = 38 };
+	enum BuiltIn : uint32_t { BuiltInNumWorkgroups = 24, BuiltInWorkgroupSize = 25 };
+	static constexpr uint32_t noSpecId = -1;
+
+	std::vector<Binding> bindings;
+	std::vector<PushConstant> pushConstants;
+	uint32_t pushConstantSize = 0;
+	UniformBlock uniformBlock;
+	bool hasUniformBlock = false;
+	uint32_t localSize[3] = {1, 1, 1};
+	uint32_t localSizeSpecId[3] = {noSpecId, noSpecId, noSpecId};	// Specialization constant controlling each dimension (if any)
+	bool numWorkgroups = false;		// Whether the shader declares gl_NumWorkGroups
+
+public:
+	SpirvReflection() = default;
+	SpirvReflection(const std::vector<uint32_t>& spirv) { reflect(spirv); }
+
+	const std::vector<Binding>& getBindings() const { return bindings; }
+
+	// The members of the push constant block, and the size of the block (in bytes)
+	const std::vector<PushConstant>& getPushConstants() const { return pushConstants; }
+	uint32_t getPushConstantSize() const { return pushConstantSize; }
+
+	// Returns the push constant member with the given name (nullptr if the block doesn't have one)
+	const PushConstant* findPushConstant(const std::string& name) const {
+		for(const PushConstant& p: pushConstants)
+			if(p.name == name)
+				return &p;
+		return nullptr;
+	}
+
+	// The uniform block declared by the shader (nullptr if it doesn't declare one)
+	const UniformBlock* getUniformBlock() const { return hasUniformBlock ? &uniformBlock : nullptr; }
+
+	// The workgroup size declared by the shader (local_size_x/y/z)
+	uint32_t getLocalSize(uint32_t dimension) const { return localSize[dimension]; }
+	uint32_t getLocalSizeX() const { return localSize[0]; }
+
+	// Whether the shader reads gl_NumWorkGroups (which only counts the groups of the current dispatch)
+	bool usesNumWorkgroups() const { return numWorkgroups; }
+
+	// The workgroup size once the given specialization constants (id -> value) have been applied
+	//  (for shaders declaring their size with local_size_x_id)
+	template <class Constants>
+	uint32_t getLocalSize(uint32_t dimension, const Constants& constants) const {
+		auto found = constants.find(localSizeSpecId[dimension]);
+		return found == constants.end() ? localSize[dimension] : found->second;
+	}
+
+	// Returns the reflected binding with the given set and binding number (nullptr if the shader doesn't declare it)
+	const Binding* find(uint32_t binding, uint32_t set = 0) const {
+		for(const Binding& b: bindings)
+			if(b.set == set && b.binding == binding)
+				return &b;
+		return nullptr;
+	}
+
+	bool reads(uint32_t binding, uint32_t set = 0) const {
+		const Binding* b = find(binding, set);
+		return b && b->reads;
+	}
+
+	bool writes(uint32_t binding, uint32_t set = 0) const {
+		const Binding* b = find(binding, set);
+		return b && b->writes;
+	}
+
+protected:
+	struct Decorations {
+		uint32_t set = 0, binding = 0;
+		uint32_t specId = noSpecId;
+		bool hasBinding = false, block = false, bufferBlock = false, nonWritable = false, nonReadable = false, workgroupSize = false;
+	};
+
+	void reflect(const std::vector<uint32_t>& spirv){
+		if(spirv.size() < 5 || spirv[0] != 0x07230203) assert(0 && "Error: Invalid SPIR-V module!");
+
+		std::map<uint32_t, Decorations> decorations;		// Decorations of each id
+		std::map<uint32_t, std::vector<bool>> nonWritableMembers, nonReadableMembers;	// Member qualifiers of each struct
+		std::map<uint32_t, uint32_t> memberCounts;			// Number of members in each struct type
+		std::map<uint32_t, uint32_t> pointee;				// Type pointed to by each pointer type
+		std::map<uint32_t, size_t> variables;				// Buffer variable -> index in bindings
+		std::map<uint32_t, uint32_t> roots;					// Pointer -> buffer variable it points into
+		std::map<uint32_t, uint32_t> constants;				// Scalar (spec) constant -> its (default) value
+		std::vector<uint32_t> localSizeIds;					// Constants making up the workgroup size (if it isn't a literal)
+		std::map<uint32_t, std::vector<uint32_t>> types;	// Type declarations (without the opcode word), by id
+		std::map<uint32_t, uint32_t> arrayStrides;
+		std::map<std::pair<uint32_t, uint32_t>, uint32_t> memberOffsets, matrixStrides;	// By (struct, member)
+		std::map<std::pair<uint32_t, uint32_t>, std::string> memberNames;
+		uint32_t pushConstantType = 0;						// Struct type of the push constant block (0 if there isn't one)
+		uint32_t uniformType = 0;							// Struct type of the uniform block (0 if there isn't one)
+
+		// Returns the index of the buffer a pointer refers to (-1 if it doesn't point into a buffer)
+		auto rootOf = [&](uint32_t pointer) -> size_t {
+			auto root = roots.find(pointer);
+			return root == roots.end() ? -1 : variables[root->second];
+		};
+		auto markRead = [&](uint32_t pointer){ size_t i = rootOf(pointer); if(i != size_t(-1)) bindings[i].reads = true; };
+		auto markWrite = [&](uint32_t pointer){ size_t i = rootOf(pointer); if(i != size_t(-1)) bindings[i].writes = true; };
+
+		for(size_t word = 5; word < spirv.size(); ){
+			uint32_t opcode = spirv[word] & 0xFFFF, count = spirv[word] >> 16;
+			if(count == 0 || word + count > spirv.size()) assert(0 && "Error: Malformed SPIR-V instruction!");
+			const uint32_t* op = &spirv[word];
+
+			switch(opcode){
+			case OpExecutionMode:
+				if(op[2] == ExecutionModeLocalSize && count >= 6){
+					localSize[0] = op[3];
+					localSize[1] = op[4];
+					localSize[2] = op[5];
+				}
+				break;
+			case OpExecutionModeId:
+				if(op[2] == ExecutionModeLocalSizeId && count >= 6)
+					localSizeIds.assign(op + 3, op + 6);
+				break;
+			case OpConstant: case OpSpecConstant:
+				if(count >= 4) constants[op[2]] = op[3];
+				break;
+			case OpSpecConstantComposite:
+				// The WorkgroupSize builtin overrides the execution mode (it is how local_size_x_id is expressed)
+				if(decorations[op[2]].workgroupSize && count >= 6)
+					localSizeIds.assign(op + 3, op + 6);
+				break;
+			case OpDecorate: {
+				Decorations& d = decorations[op[1]];
+				switch(op[2]){
+				case DecorationBinding: d.binding = op[3]; d.hasBinding = true; break;
+				case DecorationDescriptorSet: d.set = op[3]; break;
+				case DecorationBlock: d.block = true; break;
+				case DecorationBufferBlock: d.bufferBlock = true; break;
+				case DecorationNonWritable: d.nonWritable = true; break;
+				case DecorationNonReadable: d.nonReadable = true; break;
+				case DecorationSpecId: d.specId = op[3]; break;
+				case DecorationBuiltIn:
+					d.workgroupSize = op[3] == BuiltInWorkgroupSize;
+					if(op[3] == BuiltInNumWorkgroups) numWorkgroups = true;
+					break;
+				case DecorationArrayStride: arrayStrides[op[1]] = op[3]; break;
+				}
+				break;
+			}
+			case OpMemberName:
+				memberNames[{op[1], op[2]}] = readString(op + 3, count - 3);
+				break;
+			case OpTypeBool: case OpTypeInt: case OpTypeFloat: case OpTypeVector: case OpTypeMatrix: case OpTypeArray:
+				types[op[1]].assign(op, op + count);
+				break;
+			case OpMemberDecorate:
+				if(op[3] == DecorationOffset && count >= 5) memberOffsets[{op[1], op[2]}] = op[4];
+				if(op[3] == DecorationMatrixStride && count >= 5) matrixStrides[{op[1], op[2]}] = op[4];
+				if(op[3] == DecorationNonWritable || op[3] == DecorationNonReadable){
+					std::vector<bool>& members = (op[3] == DecorationNonWritable ? nonWritableMembers : nonReadableMembers)[op[1]];
+					if(members.size() <= op[2]) members.resize(op[2] + 1);
+					members[op[2]] = true;
+				}
+				break;
+			case OpTypeStruct:
+				memberCounts[op[1]] = count - 2;
+				types[op[1]].assign(op, op + count);
+				break;
+			case OpTypePointer:
+				pointee[op[1]] = op[3];
+				break;
+			case OpVariable: {
+				// Storage buffers are StorageBuffer variables (or Uniform variables of a BufferBlock decorated struct)
+				uint32_t type = pointee[op[1]], id = op[2], storage = op[3];
+				if(storage == StorageClassPushConstant) pushConstantType = type;
+				if(storage == StorageClassUniform && decorations[type].block && !uniformType){
+					uniformType = type;
+					uniformBlock.set = decorations[id].set;
+					uniformBlock.binding = decorations[id].binding;
+				}
+				bool storageBuffer = storage == StorageClassStorageBuffer || (storage == StorageClassUniform && decorations[type].bufferBlock);
+				if(!storageBuffer || !decorations[id].hasBinding) break;
+
+				Binding b;
+				b.set = decorations[id].set;
+				b.binding = decorations[id].binding;
+				// A qualifier applies to the whole buffer if it is on the variable, or on every member of its block
+				b.nonWritable = decorations[id].nonWritable || allMembers(nonWritableMembers, type, memberCounts[type]);
+				b.nonReadable = decorations[id].nonReadable || allMembers(nonReadableMembers, type, memberCounts[type]);
+				variables[id] = bindings.size();
+				roots[id] = id;
+				bindings.push_back(b);
+				break;
+			}
+			case OpAccessChain: case OpInBoundsAccessChain: case OpPtrAccessChain: case OpInBoundsPtrAccessChain: case OpCopyObject: {
+				auto root = roots.find(op[3]);
+				if(root != roots.end()) roots[op[2]] = root->second;
+				break;
+			}
+			case OpLoad: case OpAtomicLoad:
+				markRead(op[3]);
+				break;
+			case OpStore: case OpAtomicStore:
+				markWrite(op[1]);
+				break;
+			case OpCopyMemory:
+				markWrite(op[1]);
+				markRead(op[2]);
+				break;
+			case OpFunctionCall:
+				// Pointers passed to a function could be used in any way
+				for(uint32_t i = 4; i < count; i++){
+					markRead(op[i]);
+					markWrite(op[i]);
+				}
+				break;
+			default: {
+				// Atomics (including those added by extensions), and anything else we don't recognize, might read and write
+				//  through any buffer pointer they are given
+				if(ignoresPointers(opcode)) break;
+				uint32_t root = 0;
+				for(uint32_t i = 1; i < count; i++){
+					auto found = roots.find(op[i]);
+					if(found == roots.end()) continue;
+					markRead(op[i]);
+					markWrite(op[i]);
+					root = found->second;
+				}
+				// The result (if there is one) might point into the buffer as well
+				if(root && count > 2 && !roots.count(op[2])) roots[op[2]] = root;
+			}
+			}
+
+			word += count;
+		}
+
+		// Resolve the workgroup size if it is made up of (specialization) constants
+		for(size_t i = 0; i < localSizeIds.size(); i++){
+			auto value = constants.find(localSizeIds[i]);
+			if(value != constants.end()) localSize[i] = value->second;
+			localSizeSpecId[i] = decorations[localSizeIds[i]].specId;
+		}
+
+		// Lay out the members of the push constant and uniform blocks
+		std::function<uint32_t(uint32_t, uint32_t)> sizeOf = [&](uint32_t type, uint32_t matrixStride) -> uint32_t {
+			const std::vector<uint32_t>& t = types[type];
+			if(t.empty()) return 0;
+			switch(t[0] & 0xFFFF){
+			case OpTypeBool: return 4;
+			case OpTypeInt: case OpTypeFloat: return t[2] / 8;
+			case OpTypeVector: return t[3] * sizeOf(t[2], 0);
+			case OpTypeMatrix: return t[3] * (matrixStride ? matrixStride : sizeOf(t[2], 0));
+			case OpTypeArray: return constants[t[3]] * arrayStrides[type];
+			case OpTypeStruct: {
+				uint32_t size = 0;
+				for(uint32_t m = 0; m + 2 < t.size(); m++)
+					size = std::max(size, memberOffsets[{type, m}] + sizeOf(t[m + 2], matrixStrides[{type, m}]));
+				return size;
+			}
+			}
+			return 0;
+		};
+		auto layoutBlock = [&](uint32_t blockType, std::vector<BlockMember>& members, uint32_t& size){
+			const std::vector<uint32_t>& block = types[blockType];
+			for(uint32_t m = 0; m + 2 < block.size(); m++){
+				BlockMember p;
+				p.name = memberNames[{blockType, m}];
+				p.offset = memberOffsets[{blockType, m}];
+				p.size = sizeOf(block[m + 2], matrixStrides[{blockType, m}]);
+
+				// Scalars and vectors get a component type (so values can be converted to it)
+				const std::vector<uint32_t>& t = types[block[m + 2]];
+				const std::vector<uint32_t>& component = !t.empty() && (t[0] & 0xFFFF) == OpTypeVector ? types[t[2]] : t;
+				if(!t.empty() && (t[0] & 0xFFFF) == OpTypeVector) p.components = t[3];
+				if(!component.empty() && (component[0] & 0xFFFF) == OpTypeFloat) p.type = BlockMember::Type::Float;
+				if(!component.empty() && (component[0] & 0xFFFF) == OpTypeInt) p.type = component[3] ? BlockMember::Type::Int : BlockMember::Type::UInt;
+				if(p.type != BlockMember::Type::Other && p.size != 4 * p.components) p.type = BlockMember::Type::Other; // Only 32 bit components are converted
+
+				members.push_back(p);
+				size = std::max(size, p.offset + p.size);
+			}
+		};
+		if(pushConstantType) layoutBlock(pushConstantType, pushConstants, pushConstantSize);
+		if(uniformType){
+			layoutBlock(uniformType, uniformBlock.members, uniformBlock.size);
+			hasUniformBlock = true;
+		}
+
+		// The qualifiers are promises about how the buffer is used
+		for(Binding& b: bindings){
+			if(b.nonWritable) b.writes = false;
+			if(b.nonReadable) b.reads = false;
+		}
+	}
+
+	// Instructions which don't access memory through pointer operands, but which might have literal operands that could
+	//  be mistaken for a pointer's id (debug info, declarations, decorations, composites, and structured control flow)
+	static bool ignoresPointers(uint32_t opcode){
+		return (opcode <= OpCapability && opcode != OpExtInst) || (opcode >= OpTypeVoid && opcode <= OpSpecConstantOp)
+			|| (opcode >= OpFunction && opcode <= OpFunctionEnd) || opcode == OpArrayLength || (opcode >= OpDecorate && opcode <= OpGroupMemberDecorate)
+			|| (opcode >= OpVectorExtractDynamic && opcode <= OpCompositeInsert) || (opcode >= OpLoopMerge && opcode <= OpSwitch)
+			|| opcode == OpNoLine || opcode == OpModuleProcessed || opcode == OpDecorateId || opcode == OpDecorateString || opcode == OpMemberDecorateString;
+	}
+
+	// Reads a null terminated string packed into words
+	static std::string readString(const uint32_t* words, size_t count){
+		std::string out;
+		for(size_t i = 0; i < count * 4; i++){
+			char c = (words[i / 4] >> (8 * (i % 4))) & 0xFF;
+			if(!c) break;
+			out += c;
+		}
+		return out;
+	}
+
+	static bool allMembers(std::map<uint32_t, std::vector<bool>>& members, uint32_t type, uint32_t memberCount){
+		auto found = members.find(type);
+		if(found == members.end() || memberCount == 0 || found->second.size() < memberCount) return false;
+		for(uint32_t i = 0; i < memberCount; i++)
+			if(!found->second[i]) return false;
+		return true;
+	}
+};
+
+#endif // __SPIRV_REFLECTION_VULK_H__
@@ -0,0 +1,305 @@
+#ifndef __STAGING_RING_VULK_H__
+#define __STAGING_RING_VULK_H__
+
+#include "DeviceAllocator.hpp"
+#include "Timeline.hpp"
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include <algorithm>
+#include <future>
+#include <mutex>
+#include <cassert>
+
+// Persistently mapped, host visible buffer which all transfers between the host and device buffers are staged through.
+//  Space is handed out linearly (wrapping back to the start once the end is reached) and each region stays reserved
+//  until the fence of the submission which used it has signaled. Command buffers and fences are recycled between
+//  transfers so that, once the ring is created, transfering data creates no Vulkan objects.
+// Transfers are submitted to the transfer queue, each one signals the transfer timeline (its serial is the value it
+//  signals) and can wait for a value of the compute timeline before it starts.
+// The ring is locked while in use, so a TransferHandle's future can finish its transfer from another thread.
+class TransferHandle;
+class StagingRing {
+public:
+	// A region of the ring, along with the command buffer the transfer using it should be recorded into
+	struct Transfer {
+		vk::CommandBuffer commandBuffer;
+		vk::Buffer buffer;			// The ring's buffer
+		vk::DeviceSize offset;		// Offset of the region within the ring's buffer
+		vk::DeviceSize size;		// Size of the region
+		uint8_t* mapped;			// Host pointer to the start of the region
+		uint32_t slot;
+	};
+
+protected:
+	// Bookkeeping for a single (possibly in flight) submission
+	struct Slot {
+		vk::CommandBuffer commandBuffer;
+		vk::Fence fence;
+		vk::DeviceSize begin = 0;	// Region of the ring used by the submission
+		uint64_t serial = 0;		// Submission number (0 until the transfer is submitted)
+		std::function<void()> onComplete;	// Run once the submission finishes (before its region is reused)
+	};
+
+	DeviceAllocator& allocator;
+	vk::Device device;
+	vk::Queue queue;
+	Timeline& timeline;			// Timeline signaled by the ring's submissions
+	Timeline& computeTimeline;	// Timeline transfers can wait on
+
+	vk::CommandPool commandPool;
+	DeviceAllocation allocation;
+	vk::Buffer buffer;
+	uint8_t* mapped = nullptr;
+
+	vk::DeviceSize capacity;	// Size (in bytes) of the ring
+	vk::DeviceSize head = 0;	// Offset the next region will be placed at (if it fits)
+
+	std::vector<Slot> slots;
+	std::vector<uint32_t> freeSlots;
+	std::deque<uint32_t> inFlight;	// Slots in the order they were handed out
+
+	uint64_t completed = 0;		// Serial of the most recent submission known to have finished
+	std::recursive_mutex mutex;
+
+public:
+	// Alignment of every region handed out by the ring (satisfies the alignment of any type we copy)
+	static constexpr vk::DeviceSize alignment = 16;
+
+	StagingRing(DeviceAllocator& _allocator, vk::Device _device, vk::Queue _queue, uint32_t queueIndex, Timeline& _timeline, Timeline& _computeTimeline, vk::DeviceSize size, uint32_t slotCount)
+	: allocator(_allocator), device(_device), queue(_queue), timeline(_timeline), computeTimeline(_computeTimeline), capacity(size) {
+		if(capacity < alignment) assert(0 && "Error: Staging ring is too small!");
+		if(slotCount < 1) slotCount = 1;
+
+		// Create the buffer
+		buffer = device.createBuffer( {{}, capacity, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eTransferSrc, vk::SharingMode::eExclusive, 1, &queueIndex} );
+		auto requirements = device.getBufferMemoryRequirements(buffer);
+
+		// Place it in host visible memory (which the allocator keeps mapped), in a block of its own so the ring doesn't
+		//  claim a whole shared block after being rounded up to a size class
+		allocation = allocator.allocate(requirements, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, {}, /*dedicated*/ true);
+		device.bindBufferMemory(buffer, allocation.memory, allocation.offset);
+		mapped = allocation.mapped;
+
+		// Create the command buffers and fences which will be recycled between transfers
+		commandPool = device.createCommandPool( {vk::CommandPoolCreateFlagBits::eResetCommandBuffer | vk::CommandPoolCreateFlagBits::eTransient, queueIndex} );
+		auto commandBuffers = device.allocateCommandBuffers( {commandPool, vk::CommandBufferLevel::ePrimary, slotCount} );
+		slots.resize(slotCount);
+		for(uint32_t i = 0; i < slotCount; i++){
+			slots[i].commandBuffer = commandBuffers[i];
+			slots[i].fence = device.createFence( {} );
+			freeSlots.push_back(slotCount - i - 1);
+		}
+	}
+
+	StagingRing(const StagingRing&) = delete;
+	StagingRing& operator=(const StagingRing&) = delete;
+
+	~StagingRing(){
+		// Make sure nothing is still using the ring
+		waitAll();
+
+		for(Slot& slot: slots)
+			device.destroy(slot.fence);
+		device.destroy(commandPool);
+
+		device.destroy(buffer);
+		allocator.free(allocation);
+	}
+
+	// The largest transfer which should be staged through the ring at once (larger transfers should be split up),
+	//  limited to half the ring so that one chunk can be filled while the previous one is in flight
+	vk::DeviceSize maxTransferSize() const {
+		vk::DeviceSize out = capacity / 2;
+		return out - out % alignment;
+	}
+
+	// Reserves <size> bytes of the ring and begins recording a command buffer for the transfer using them.
+	//  Blocks (retiring finished transfers) until enough space is available.
+	Transfer begin(vk::DeviceSize size){
+		if(size > capacity) assert(0 && "Error: Transfer is larger than the staging ring!");
+		std::lock_guard<std::recursive_mutex> lock(mutex);
+
+		// Clean up anything which has already finished
+		collect();
+
+		// Find a free slot (taking it right away, since retiring transfers below pushes the slots they free)
+		while(freeSlots.empty()) retireOldest();
+		uint32_t index = freeSlots.back();
+		freeSlots.pop_back();
+
+		// Find space for the transfer in the ring
+		vk::DeviceSize offset;
+		while(!reserve(size, offset)) retireOldest();
+
+		Slot& slot = slots[index];
+		slot.begin = offset;
+		slot.serial = 0;
+		inFlight.push_back(index);
+		head = offset + size;
+
+		slot.commandBuffer.reset( {} );
+		slot.commandBuffer.begin( {vk::CommandBufferUsageFlagBits::eOneTimeSubmit, nullptr} );
+
+		return {slot.commandBuffer, buffer, offset, size, mapped + offset, index};
+	}
+
+	// Finishes recording the transfer's command buffer and submits it, returns the submission's serial.
+	//  <onComplete> is called once the transfer has finished (while its region of the ring is still valid)
+	//  The transfer won't start until the compute timeline reaches <computeValue>.
+	uint64_t submit(Transfer& transfer, std::function<void()> onComplete = {}, uint64_t computeValue = 0){
+		std::lock_guard<std::recursive_mutex> lock(mutex);
+		Slot& slot = slots[transfer.slot];
+		slot.commandBuffer.end();
+		uint64_t serial = timeline.upcoming();
+
+		// Signal the transfer timeline (and wait on the compute timeline if needed)
+		vk::Semaphore signal = timeline.get(), wait = computeTimeline.get();
+		vk::PipelineStageFlags waitStage = vk::PipelineStageFlagBits::eTransfer;
+		uint32_t waitCount = computeValue > 0 ? 1 : 0;
+		vk::TimelineSemaphoreSubmitInfo timelineInfo(waitCount, &computeValue, 1, &serial);
+		vk::SubmitInfo si(waitCount, &wait, &waitStage, 1, &slot.commandBuffer, 1, &signal);
+		si.pNext = &timelineInfo;
+		try {
+			queue.submit(si, slot.fence);
+		} catch(...) {
+			// Nothing was submitted, so hand the slot (and its region) back rather than waiting on it forever
+			inFlight.erase(std::find(inFlight.begin(), inFlight.end(), transfer.slot));
+			freeSlots.push_back(transfer.slot);
+			throw;
+		}
+
+		// Only reserve the serial once the submission has been made
+		slot.onComplete = std::move(onComplete);
+		slot.serial = timeline.next();
+		return slot.serial;
+	}
+
+	// Blocks until the submission with the given serial (and every one before it) has finished
+	void wait(uint64_t serial){
+		std::lock_guard<std::recursive_mutex> lock(mutex);
+		while(completed < serial) retireOldest();
+	}
+
+	// Blocks until the submission with the given serial has finished, only holding the lock once the device is done
+	//  with it (so other threads can keep using the ring in the meantime)
+	void waitFromThread(uint64_t serial){
+		timeline.waitSignaled(serial);
+		wait(serial);
+	}
+
+	// Blocks until every submission has finished
+	void waitAll(){
+		wait(timeline.last());
+	}
+
+	// Returns true if the submission with the given serial has finished
+	bool ready(uint64_t serial){
+		std::lock_guard<std::recursive_mutex> lock(mutex);
+		collect();
+		return completed >= serial;
+	}
+
+protected:
+	// Attempts to find <size> bytes of free space in the ring, returns false if there isn't enough
+	bool reserve(vk::DeviceSize size, vk::DeviceSize& offset){
+		// If nothing is in flight the whole ring is available
+		if(inFlight.empty()){
+			head = 0;
+			offset = 0;
+			return size <= capacity;
+		}
+
+		vk::DeviceSize tail = slots[inFlight.front()].begin;
+		vk::DeviceSize start = (head + alignment - 1) / alignment * alignment;
+
+		// The in flight regions are contiguous, so there is space both after the head and before the tail
+		if(head >= tail){
+			if(start + size <= capacity){
+				offset = start;
+				return true;
+			}
+			// Wrap around to the start of the ring (the head should never catch up to the tail)
+			if(size < tail){
+				offset = 0;
+				return true;
+			}
+			return false;
+		}
+
+		// The in flight regions have wrapped, so there is only space between the head and the tail
+		if(start + size < tail){
+			offset = start;
+			return true;
+		}
+		return false;
+	}
+
+	// Waits for the oldest submission to finish and frees its slot and region
+	void retireOldest(){
+		if(inFlight.empty()) return;
+
+		Slot& slot = slots[inFlight.front()];
+		if(!slot.serial) assert(0 && "Error: Staging ring transfer was never submitted!");
+
+		(void) device.waitForFences(slot.fence, VK_TRUE, UINT64_MAX);
+		release(inFlight.front());
+	}
+
+	// Frees every submission which has already finished (without blocking)
+	void collect(){
+		while(!inFlight.empty()){
+			Slot& slot = slots[inFlight.front()];
+			if(!slot.serial || device.getFenceStatus(slot.fence) != vk::Result::eSuccess)
+				break;
+			release(inFlight.front());
+		}
+	}
+
+	void release(uint32_t index){
+		Slot& slot = slots[index];
+		device.resetFences(slot.fence);
+		completed = slot.serial;
+
+		if(slot.onComplete){
+			slot.onComplete();
+			slot.onComplete = nullptr;
+		}
+
+		inFlight.pop_front();
+		freeSlots.push_back(index);
+	}
+};
+
+// Handle to a (possibly still in flight) transfer staged through the ring
+class TransferHandle {
+	StagingRing* ring = nullptr;
+	uint64_t serial = 0;
+
+public:
+	// Default constructed handles refer to transfers which completed immediately
+	TransferHandle() = default;
+	TransferHandle(StagingRing* _ring, uint64_t _serial) : ring(_ring), serial(_serial) {}
+
+	// Blocks until the transfer has finished
+	void wait(){
+		if(ring) ring->wait(serial);
+	}
+
+	// Returns true if the transfer has finished
+	bool ready(){
+		return !ring || ring->ready(serial);
+	}
+
+	// Adapts the handle into a future which becomes ready once the transfer has finished (and, for readbacks, its data
+	//  has been copied out of the ring). The transfer is waited on by a thread of its own.
+	//  NOTE: The future must be waited on before the context is destroyed
+	std::future<void> future(){
+		StagingRing* r = ring;
+		uint64_t s = serial;
+		return std::async(std::launch::async, [r, s]{ if(r) r->waitFromThread(s); });
+	}
+};
+
+#endif // __STAGING_RING_VULK_H__
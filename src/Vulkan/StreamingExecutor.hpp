@@ -0,0 +1,258 @@
+#ifndef __STREAMING_EXECUTOR_VULK_H__
+#define __STREAMING_EXECUTOR_VULK_H__
+#include "ComputeShader.hpp"
+
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+
+/////  Sources and Sinks  /////
+
+// Where the data processed by a StreamingExecutor comes from
+class StreamSource {
+public:
+	virtual ~StreamSource() {}
+	// Total number of bytes available
+	virtual vk::DeviceSize size() = 0;
+	// Reads <size> bytes starting at <offset> into <dst>
+	virtual void read(void* dst, vk::DeviceSize offset, vk::DeviceSize size) = 0;
+};
+
+// Where the data produced by a StreamingExecutor goes
+class StreamSink {
+public:
+	virtual ~StreamSink() {}
+	// Writes <size> bytes from <src> starting at <offset>
+	virtual void write(const void* src, vk::DeviceSize offset, vk::DeviceSize size) = 0;
+};
+
+class HostSource: public StreamSource {
+	const uint8_t* data;
+	vk::DeviceSize bytes;
+public:
+	HostSource(const void* _data, vk::DeviceSize _bytes) : data((const uint8_t*) _data), bytes(_bytes) {}
+	template <class T>
+	HostSource(const std::vector<T>& v) : HostSource(v.data(), v.size() * sizeof(T)) {}
+
+	vk::DeviceSize size() { return bytes; }
+	void read(void* dst, vk::DeviceSize offset, vk::DeviceSize size) { memcpy(dst, data + offset, size); }
+};
+
+class HostSink: public StreamSink {
+	uint8_t* data;
+public:
+	HostSink(void* _data) : data((uint8_t*) _data) {}
+	template <class T>
+	HostSink(std::vector<T>& v) : HostSink(v.data()) {}
+
+	void write(const void* src, vk::DeviceSize offset, vk::DeviceSize size) { memcpy(data + offset, src, size); }
+};
+
+class FileSource: public StreamSource {
+	std::ifstream file;
+	vk::DeviceSize bytes;
+public:
+	FileSource(const std::string& path) : file(path, std::ios::binary | std::ios::ate) {
+		if(!file) assert(0 && "Error: Failed to open stream source file!");
+		bytes = file.tellg();
+	}
+
+	vk::DeviceSize size() { return bytes; }
+	void read(void* dst, vk::DeviceSize offset, vk::DeviceSize size) {
+		file.seekg(offset);
+		file.read((char*) dst, size);
+	}
+};
+
+class FileSink: public StreamSink {
+	std::ofstream file;
+public:
+	FileSink(const std::string& path) : file(path, std::ios::binary | std::ios::trunc) {
+		if(!file) assert(0 && "Error: Failed to open stream sink file!");
+	}
+
+	void write(const void* src, vk::DeviceSize offset, vk::DeviceSize size) {
+		file.seekp(offset);
+		file.write((const char*) src, size);
+	}
+};
+
+
+/////  Executor  /////
+
+// Runs a ComputeShader over a dataset too large to fit on the GPU at once. The input is split into chunks which flow
+//  through an upload -> dispatch -> readback pipeline with <depth> sets of buffers in flight, so that while one chunk is
+//  being processed the next is being uploaded and the previous is being read back (on the transfer queue).
+// The shader sees each chunk's input at <inputBinding> and writes its output to <outputBinding>. The start of its push
+//  constants is overwritten with the chunk's position, it should declare:
+//		layout(push_constant) uniform Chunk { uint chunkOffset; uint chunkElements; uint chunkOffsetHigh; };
+//  where chunkOffset is the index (in elements) of the chunk's first element and chunkElements is the number of elements
+//  in the chunk (the last chunk may be short, so invocations past the end should do nothing). chunkOffsetHigh holds the
+//  upper 32 bits of the index, shaders which leave it out can only stream up to 2^32 elements.
+class StreamingExecutor {
+public:
+	// Time spent (and bytes moved) in each stage of the pipeline, measured on the host. Sourcing is reading the source
+	//  and copying it into the staging ring (the upload itself overlaps the other stages), dispatching is the time spent
+	//  waiting for a chunk's kernel (and the upload it depends on) once its slot is needed again, and reading back is the
+	//  time spent waiting for the readback and writing to the sink.
+	struct Stats {
+		uint64_t chunks = 0;
+		vk::DeviceSize bytesIn = 0, bytesOut = 0;
+		double sourceSeconds = 0, dispatchSeconds = 0, readbackSeconds = 0, totalSeconds = 0;
+
+		static double gbps(vk::DeviceSize bytes, double seconds) { return seconds > 0 ? bytes / seconds / 1e9 : 0; }
+		double sourceThroughput() const { return gbps(bytesIn, sourceSeconds); }
+		double dispatchThroughput() const { return gbps(bytesIn, dispatchSeconds); }
+		double readbackThroughput() const { return gbps(bytesOut, readbackSeconds); }
+		double totalThroughput() const { return gbps(bytesIn, totalSeconds); }
+	};
+
+protected:
+	using Clock = std::chrono::high_resolution_clock;
+
+	// Buffers (and host storage) used by one chunk in flight
+	struct Slot {
+		std::unique_ptr<ComputeBuffer> input, output;
+		std::vector<uint8_t> readback;		// Host storage the input is read into and the output is read back into
+		DispatchHandle dispatch;			// Kernel processing the chunk currently using the slot
+		TransferHandle pending;				// Readback of the chunk currently using the slot
+		vk::DeviceSize outputOffset = 0, outputSize = 0;
+		bool busy = false;
+	};
+
+	VulkanContext& context;
+	ComputeShader& shader;
+	vk::DeviceSize chunkSize, outputChunkSize, elementSize, elementsPerGroup;
+	std::vector<Slot> slots;
+	Stats stats;
+
+public:
+	// <chunkSize> bytes of input produce <outputChunkSize> bytes of output, and are processed by one invocation per
+	//  <elementSize> bytes with <elementsPerGroup> invocations per workgroup (the shader's local size)
+	StreamingExecutor(VulkanContext& _context, ComputeShader& _shader, uint32_t inputBinding, uint32_t outputBinding, vk::DeviceSize _chunkSize, vk::DeviceSize _elementSize, vk::DeviceSize _elementsPerGroup, uint32_t depth = 3, vk::DeviceSize _outputChunkSize = 0)
+	: context(_context), shader(_shader), chunkSize(_chunkSize), outputChunkSize(_outputChunkSize ? _outputChunkSize : _chunkSize), elementSize(_elementSize), elementsPerGroup(_elementsPerGroup) {
+		if(!chunkSize || !elementSize || !elementsPerGroup || chunkSize % elementSize) assert(0 && "Error: Chunks must contain a whole number of elements!");
+		if(chunkSize / elementSize > UINT32_MAX) assert(0 && "Error: Chunks can't contain more than 2^32 elements!");
+		// The next chunk is uploaded before the current one is processed, so at least two sets of buffers are needed
+		if(depth < 2) depth = 2;
+
+		slots.resize(depth);
+		for(Slot& slot: slots){
+			slot.input.reset( new ComputeBuffer(context, inputBinding, chunkSize, nullptr, 0, 0, ComputeBuffer::Residency::DeviceLocal) );
+			slot.output.reset( new ComputeBuffer(context, outputBinding, outputChunkSize, nullptr, 0, 0, ComputeBuffer::Residency::DeviceLocal) );
+			slot.readback.resize(std::max(chunkSize, outputChunkSize));
+		}
+	}
+
+	~StreamingExecutor(){
+		// Make sure nothing is still using our buffers or reading back into our storage
+		for(Slot& slot: slots){
+			slot.dispatch.wait();
+			slot.pending.wait();
+		}
+	}
+
+	// Streams the whole source through the shader into the sink
+	const Stats& run(StreamSource& source, StreamSink& sink){
+		stats = Stats();
+		Clock::time_point start = Clock::now();
+
+		const vk::DeviceSize total = source.size();
+		const uint64_t chunkCount = (total + chunkSize - 1) / chunkSize;
+
+		// Upload the first chunk, then for each chunk: upload the next one, process this one, and start reading it back
+		if(chunkCount) upload(source, sink, 0, total);
+		for(uint64_t chunk = 0; chunk < chunkCount; chunk++){
+			if(chunk + 1 < chunkCount) upload(source, sink, chunk + 1, total);
+			process(chunk, total);
+		}
+
+		// Drain whatever is still in flight
+		for(Slot& slot: slots)
+			finish(slot, sink);
+
+		stats.chunks = chunkCount;
+		stats.totalSeconds = seconds(start);
+		return stats;
+	}
+
+	const Stats& getStats() { return stats; }
+
+protected:
+	static double seconds(Clock::time_point since){
+		return std::chrono::duration<double>(Clock::now() - since).count();
+	}
+
+	vk::DeviceSize chunkBytes(uint64_t chunk, vk::DeviceSize total){
+		return std::min(chunkSize, total - chunk * chunkSize);
+	}
+
+	// Writes the output of the chunk using the slot (if any) to the sink, freeing the slot
+	void finish(Slot& slot, StreamSink& sink){
+		if(!slot.busy) return;
+
+		Clock::time_point start = Clock::now();
+		slot.dispatch.wait();
+		stats.dispatchSeconds += seconds(start);
+
+		start = Clock::now();
+		slot.pending.wait();
+		sink.write(slot.readback.data(), slot.outputOffset, slot.outputSize);
+		stats.readbackSeconds += seconds(start);
+		stats.bytesOut += slot.outputSize;
+
+		slot.busy = false;
+	}
+
+	void upload(StreamSource& source, StreamSink& sink, uint64_t chunk, vk::DeviceSize total){
+		Slot& slot = slots[chunk % slots.size()];
+		// The slot might still be in use by an older chunk
+		finish(slot, sink);
+
+		Clock::time_point start = Clock::now();
+		vk::DeviceSize size = chunkBytes(chunk, total);
+		source.read(slot.readback.data(), chunk * chunkSize, size);
+		slot.input->setDataAsync(slot.readback.data(), 0, size);
+		stats.sourceSeconds += seconds(start);
+		stats.bytesIn += size;
+	}
+
+	void process(uint64_t chunk, vk::DeviceSize total){
+		Slot& slot = slots[chunk % slots.size()];
+		vk::DeviceSize size = chunkBytes(chunk, total);
+		uint32_t elements = size / elementSize;
+
+		// Point the shader at this chunk's buffers and tell it where the chunk is
+		shader.bindComputeBuffer(*slot.input);
+		shader.bindComputeBuffer(*slot.output);
+		uint64_t offset = chunk * chunkSize / elementSize;
+		std::vector<uint8_t> constants = shader.getPushConstants();
+		// The high half of the offset is only passed if the shader declares it
+		size_t positionSize = constants.size() >= 3 * sizeof(uint32_t) ? 3 * sizeof(uint32_t) : 2 * sizeof(uint32_t);
+		if(positionSize < 3 * sizeof(uint32_t) && offset > UINT32_MAX) assert(0 && "Error: Chunk offset doesn't fit in 32 bits, the shader needs to declare chunkOffsetHigh!");
+		if(constants.size() < positionSize) constants.resize(positionSize);
+		uint32_t position[3] = { uint32_t(offset), elements, uint32_t(offset >> 32) };
+		memcpy(constants.data(), position, positionSize);
+		shader.setPushConstants(constants);
+
+		// The kernel is only waited on once the slot is needed again, and the readback waits for it on the GPU
+		slot.dispatch = shader.dispatchAsync((elements + elementsPerGroup - 1) / elementsPerGroup);
+
+		// Start reading back the output
+		slot.outputOffset = chunk * outputChunkSize;
+		slot.outputSize = size * outputChunkSize / chunkSize;
+		slot.pending = slot.output->getDataAsync(slot.readback.data(), 0, slot.outputSize);
+		slot.busy = true;
+	}
+};
+
+inline std::ostream& operator<<(std::ostream& stream, const StreamingExecutor::Stats& stats){
+	stream << "Streamed " << stats.bytesIn << " bytes in " << stats.chunks << " chunks (" << stats.totalThroughput() << " GB/s): "
+		<< "source " << stats.sourceThroughput() << " GB/s, dispatch " << stats.dispatchThroughput() << " GB/s, readback " << stats.readbackThroughput() << " GB/s";
+	return stream;
+}
+
+#endif // __STREAMING_EXECUTOR_VULK_H__
@@ -0,0 +1,83 @@
+#ifndef __TIMELINE_VULK_H__
+#define __TIMELINE_VULK_H__
+
+#include "VulkanWrapper.hpp"
+
+#include <map>
+#include <functional>
+
+// Wrapper around a timeline semaphore which is signaled with an increasing value by every submission made to a queue,
+//  used to synchronize work between the compute and transfer queues (and with the host)
+class Timeline {
+protected:
+	vk::Device device;
+	vk::Semaphore semaphore;
+	uint64_t value = 0;		// Most recent value a submission has been told to signal
+	std::multimap<uint64_t, std::function<void()>> callbacks;	// Callbacks waiting for a value to be reached
+
+public:
+	Timeline(vk::Device _device) : device(_device) {
+		vk::SemaphoreTypeCreateInfo type(vk::SemaphoreType::eTimeline, 0);
+		vk::SemaphoreCreateInfo info;
+		info.pNext = &type;
+		semaphore = device.createSemaphore(info);
+	}
+
+	Timeline(const Timeline&) = delete;
+	Timeline& operator=(const Timeline&) = delete;
+
+	~Timeline(){
+		wait(value);
+		poll();
+		device.destroy(semaphore);
+	}
+
+	vk::Semaphore get() const { return semaphore; }
+
+	// The value the next submission should signal, which is only reserved (with next) once the submission has been
+	//  made, so a submission which fails doesn't leave behind a value that is never signaled
+	uint64_t upcoming() const { return value + 1; }
+	// Reserves the value the next submission should signal
+	uint64_t next() { return ++value; }
+	// The value signaled by the most recent submission
+	uint64_t last() const { return value; }
+
+	// Returns true if the given value has been reached
+	bool reached(uint64_t v) const {
+		return v == 0 || device.getSemaphoreCounterValue(semaphore) >= v;
+	}
+
+	// Blocks until the given value has been reached (running any callbacks which are now due)
+	void wait(uint64_t v){
+		waitSignaled(v);
+		poll();
+	}
+
+	// Blocks until the given value has been reached without running any callbacks, so it can be called from any thread
+	void waitSignaled(uint64_t v) const {
+		if(v == 0) return;
+		vk::SemaphoreWaitInfo info({}, 1, &semaphore, &v);
+		(void) device.waitSemaphores(info, UINT64_MAX);
+	}
+
+	// Calls <callback> once the given value has been reached (immediately if it already has)
+	//  NOTE: Callbacks are run on whichever thread next waits on or polls the timeline
+	void then(uint64_t v, std::function<void()> callback){
+		if(reached(v)) callback();
+		else callbacks.emplace(v, std::move(callback));
+	}
+
+	// Runs the callbacks for every value which has been reached
+	void poll(){
+		if(callbacks.empty()) return;
+		uint64_t current = device.getSemaphoreCounterValue(semaphore);
+		while(!callbacks.empty() && callbacks.begin()->first <= current){
+			// Remove the callback before running it, in case it registers more callbacks
+			std::function<void()> callback = std::move(callbacks.begin()->second);
+			callbacks.erase(callbacks.begin());
+			callback();
+		}
+	}
+};
+
+#endif // __TIMELINE_VULK_H__
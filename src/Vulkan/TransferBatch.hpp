@@ -0,0 +1,208 @@
+#ifndef __TRANSFER_BATCH_VULK_H__
+#define __TRANSFER_BATCH_VULK_H__
+#include "ComputeBuffer.hpp"
+
+#include <vector>
+#include <map>
+#include <algorithm>
+
+// Collects many (host pointer, buffer offset, size) regions, across any number of ComputeBuffers, and transfers them
+//  together: the regions are packed into a single staging ring allocation and copied with one vkCmdCopyBuffer (with
+//  one vk::BufferCopy per region) per buffer, in a single submission. Batches too large for the staging ring are split
+//  into as few submissions as possible. Uploads always land before downloads recorded in the same batch.
+//  Regions of a single copy command can't overlap, so uploads which overlap an earlier upload to the same buffer start
+//  a new copy command (after a barrier), and the later upload wins.
+class TransferBatch {
+protected:
+	struct Region {
+		ComputeBuffer* buffer;
+		uint8_t* host;
+		vk::DeviceSize offset;
+		vk::DeviceSize size;
+	};
+
+	// A region placed in the current staging ring allocation
+	struct Piece {
+		Region region;
+		vk::DeviceSize stagingOffset;	// Offset relative to the start of the allocation
+	};
+
+	VulkanContext& context;
+	std::vector<Region> uploads, downloads;
+
+	// Scratch storage reused between submissions
+	std::vector<Piece> pieces;
+	std::vector<vk::BufferCopy> copies;
+	std::map<vk::DeviceSize, vk::DeviceSize> written;	// Start -> end of the buffer regions the current copy command writes
+
+public:
+	TransferBatch(VulkanContext& _context) : context(_context) {}
+
+	// Queues copying <size> bytes from <data> into <buffer> at <offset>, the data is copied when the batch is submitted
+	void upload(ComputeBuffer& buffer, const void* data, vk::DeviceSize offset, vk::DeviceSize size){
+		if(offset + size > buffer.bufferSize) assert(0 && "Error: Upload region is outside of the buffer!");
+		if(size) uploads.push_back( {&buffer, (uint8_t*) data, offset, size} );
+	}
+
+	// Queues copying <size> bytes from <buffer> at <offset> into <data>, which must remain valid until the transfer completes
+	void download(ComputeBuffer& buffer, void* data, vk::DeviceSize offset, vk::DeviceSize size){
+		if(offset + size > buffer.bufferSize) assert(0 && "Error: Download region is outside of the buffer!");
+		if(size) downloads.push_back( {&buffer, (uint8_t*) data, offset, size} );
+	}
+
+	bool empty(){
+		return uploads.empty() && downloads.empty();
+	}
+
+	// Forgets any queued regions
+	void clear(){
+		uploads.clear();
+		downloads.clear();
+	}
+
+	// Submits every queued region and waits for the transfers to complete
+	void submit(){
+		submitAsync().wait();
+	}
+
+	// Submits every queued region and returns a handle to the (last) submission, the batch is cleared for reuse
+	TransferHandle submitAsync(){
+		StagingRing& staging = *context.staging;
+		const vk::DeviceSize capacity = staging.maxTransferSize();
+		uint64_t last = 0;
+
+		pieces.clear();
+		vk::DeviceSize used = 0;
+		size_t uploadPieces = 0;
+		bool uploading = true;
+
+		// Walk the uploads then the downloads, packing them into allocations no larger than the ring allows
+		for(std::vector<Region>* list: {&uploads, &downloads}){
+			for(Region region: *list){
+				// Host visible buffers don't need to go through the ring
+				if(region.buffer->isHostVisible()){
+					transferDirect(region, uploading);
+					continue;
+				}
+
+				// Split regions which don't fit in the current allocation
+				while(region.size){
+					if(used >= capacity){
+						last = submitPieces(used, uploadPieces);
+						used = uploadPieces = 0;
+					}
+
+					Region piece = region;
+					piece.size = std::min(region.size, capacity - used);
+					pieces.push_back( {piece, used} );
+					if(uploading) uploadPieces++;
+					used += (piece.size + StagingRing::alignment - 1) / StagingRing::alignment * StagingRing::alignment;
+
+					region.host += piece.size;
+					region.offset += piece.size;
+					region.size -= piece.size;
+				}
+			}
+			uploading = false;
+		}
+		if(!pieces.empty()) last = submitPieces(used, uploadPieces);
+
+		clear();
+		return last ? TransferHandle(&staging, last) : TransferHandle();
+	}
+
+protected:
+	// Copies a region to or from a host visible buffer
+	void transferDirect(const Region& region, bool upload){
+		if(upload) region.buffer->setData(region.host, region.offset, region.offset + region.size);
+		else region.buffer->getData(region.host, region.offset, region.offset + region.size);
+	}
+
+	// Records and submits the pieces which have been packed into the current allocation (the first <uploadCount> are uploads)
+	uint64_t submitPieces(vk::DeviceSize size, size_t uploadCount){
+		StagingRing& staging = *context.staging;
+		StagingRing::Transfer transfer = staging.begin(size);
+
+		uint64_t computeValue = 0;
+		for(Piece& piece: pieces)
+			computeValue = std::max(computeValue, piece.region.buffer->lastCompute);
+
+		// Copy the data being uploaded into the staging ring
+		for(size_t i = 0; i < uploadCount; i++)
+			memcpy(transfer.mapped + pieces[i].stagingOffset, pieces[i].region.host, pieces[i].region.size);
+
+		// Group the pieces by buffer so each buffer only needs one copy command
+		auto byBuffer = [](const Piece& a, const Piece& b){ return a.region.buffer < b.region.buffer; };
+		std::stable_sort(pieces.begin(), pieces.begin() + uploadCount, byBuffer);
+		std::stable_sort(pieces.begin() + uploadCount, pieces.end(), byBuffer);
+
+		// Record the uploads (after earlier transfers touching the buffers have landed)
+		ComputeBuffer::recordTransferBarrier(transfer.commandBuffer);
+		recordCopies(transfer, 0, uploadCount, true);
+		if(uploadCount < pieces.size()){
+			// Make sure any previous uploads have landed before anything is read back
+			vk::MemoryBarrier barrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eTransferRead);
+			transfer.commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, {}, barrier, nullptr, nullptr);
+			// Record the downloads
+			recordCopies(transfer, uploadCount, pieces.size(), false);
+			barrier = vk::MemoryBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eHostRead);
+			transfer.commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, {}, barrier, nullptr, nullptr);
+		}
+
+		// Once complete, copy the downloaded data out of the staging ring
+		std::function<void()> onComplete;
+		if(uploadCount < pieces.size()){
+			std::vector<Piece> downloaded(pieces.begin() + uploadCount, pieces.end());
+			uint8_t* mapped = transfer.mapped;
+			onComplete = [downloaded, mapped]{
+				for(const Piece& piece: downloaded)
+					memcpy(piece.region.host, mapped + piece.stagingOffset, piece.region.size);
+			};
+		}
+
+		uint64_t serial = staging.submit(transfer, std::move(onComplete), computeValue);
+		for(Piece& piece: pieces)
+			piece.region.buffer->lastTransfer = serial;
+
+		pieces.clear();
+		return serial;
+	}
+
+	// Records one copy command (with a region per piece) for each buffer in pieces[begin, end), uploads which overlap a
+	//  region already in the command are moved to a new command after a barrier (downloads write distinct parts of the
+	//  ring, so they never overlap)
+	void recordCopies(StagingRing::Transfer& transfer, size_t begin, size_t end, bool upload){
+		while(begin < end){
+			ComputeBuffer* buffer = pieces[begin].region.buffer;
+
+			copies.clear();
+			written.clear();
+			for(; begin < end && pieces[begin].region.buffer == buffer; begin++){
+				Piece& piece = pieces[begin];
+				if(upload && overlapsWritten(piece.region.offset, piece.region.size)){
+					transfer.commandBuffer.copyBuffer(transfer.buffer, buffer->buffer, copies);
+					ComputeBuffer::recordTransferBarrier(transfer.commandBuffer);
+					copies.clear();
+					written.clear();
+				}
+				written[piece.region.offset] = piece.region.offset + piece.region.size;
+
+				vk::DeviceSize stagingOffset = transfer.offset + piece.stagingOffset;
+				if(upload) copies.emplace_back(stagingOffset, piece.region.offset, piece.region.size);
+				else copies.emplace_back(piece.region.offset, stagingOffset, piece.region.size);
+			}
+
+			if(upload) transfer.commandBuffer.copyBuffer(transfer.buffer, buffer->buffer, copies);
+			else transfer.commandBuffer.copyBuffer(buffer->buffer, transfer.buffer, copies);
+		}
+	}
+
+	// Returns true if [offset, offset + size) overlaps a region the current copy command writes
+	bool overlapsWritten(vk::DeviceSize offset, vk::DeviceSize size){
+		auto next = written.lower_bound(offset);
+		if(next != written.end() && next->first < offset + size) return true;
+		return next != written.begin() && std::prev(next)->second > offset;
+	}
+};
+
+#endif // __TRANSFER_BATCH_VULK_H__
@@ -67,5 +67,19 @@ VKAPI_ATTR void VKAPI_CALL vkSubmitDebugUtilsMessageEXT(VkInstance instance, VkD
 }
 
 
+// Device level functions can only be looked up once the device exists, initVulkan loads them with loadDeviceFunctions
+//  (defined inline so every translation unit shares the loaded pointer)
+inline PFN_vkCmdPushDescriptorSetKHR& pushDescriptorSetFunction(){
+    static PFN_vkCmdPushDescriptorSetKHR func = nullptr;
+    return func;
+}
+
+inline void loadDeviceFunctions(VkDevice device){
+    pushDescriptorSetFunction() = reinterpret_cast<PFN_vkCmdPushDescriptorSetKHR>( vkGetDeviceProcAddr(device, "vkCmdPushDescriptorSetKHR") );
+}
+
+inline VKAPI_ATTR void VKAPI_CALL vkCmdPushDescriptorSetKHR(VkCommandBuffer commandBuffer, VkPipelineBindPoint pipelineBindPoint, VkPipelineLayout layout, uint32_t set, uint32_t descriptorWriteCount, const VkWriteDescriptorSet* pDescriptorWrites){
+	pushDescriptorSetFunction()(commandBuffer, pipelineBindPoint, layout, set, descriptorWriteCount, pDescriptorWrites);
+}
 
 #endif /* end of include guard: __VULKAN_WRAPPER_H__ */
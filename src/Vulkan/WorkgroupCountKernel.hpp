@@ -0,0 +1,68 @@
+#ifndef __WORKGROUP_COUNT_KERNEL_VULK_H__
+#define __WORKGROUP_COUNT_KERNEL_VULK_H__
+#include "ComputeShader.hpp"
+
+#include <string>
+#include <fstream>
+
+// Small kernel which turns an element count produced on the GPU (by a filter or compaction stage for example) into the
+//  workgroup counts needed to process that many elements, written in the layout dispatchIndirect expects. This lets the
+//  next kernel be sized without reading the count back to the host:
+//		counter.compute(countBuffer, 0, argsBuffer, 0, 32);
+//		nextShader.dispatchIndirect(argsBuffer, 0);
+//  The group count is limited to the device's maxComputeWorkGroupCount[0], so at most that many times the local size
+//  elements are covered. The args are followed by a fourth uint holding the number of elements past that limit (0 if
+//  they all fit), which the host can read back to check that nothing was dropped.
+class WorkgroupCountKernel {
+protected:
+	struct Params {
+		uint32_t countIndex;	// Index (in uints) of the element count
+		uint32_t argsIndex;		// Index (in uints) the x, y, z group counts (and the overflow) are written to
+		uint32_t localSize;		// Invocations per workgroup of the kernel being sized
+		uint32_t maxGroups;		// Largest group count the device supports
+	};
+
+	VulkanContext& context;
+	ComputeShader shader;
+
+public:
+	// Reads the kernel's GLSL from <path>, the same file is shared by the OpenGL and Vulkan backends
+	static std::string source(const std::string& path = "src/workgroupCount.glsl"){
+		std::ifstream file(path);
+		if(!file) assert(0 && "Error: Failed to open the workgroup count shader!");
+
+		const char END_OF_FILE = 26;
+		std::string src;
+		getline(file, src, END_OF_FILE);
+		return src;
+	}
+
+	// <path> is relative to the working directory, like the shaders main.cpp loads
+	WorkgroupCountKernel(VulkanContext& _context, const std::string& path = "src/workgroupCount.glsl") : context(_context), shader(_context, source(path)) {}
+
+	// Reads the element count stored in <count> at <countOffset>, and writes the workgroup counts needed to process that
+	//  many elements with <localSize> invocations per group into <args> at <argsOffset>, which needs room for 4 uints
+	//  (waiting for it to finish)
+	void compute(ComputeBuffer& count, vk::DeviceSize countOffset, ComputeBuffer& args, vk::DeviceSize argsOffset, uint32_t localSize){
+		computeAsync(count, countOffset, args, argsOffset, localSize).wait();
+	}
+
+	// Sizes the dispatch for <shader>, using the local size it declares
+	void compute(ComputeBuffer& count, vk::DeviceSize countOffset, ComputeBuffer& args, vk::DeviceSize argsOffset, ComputeShader& shader){
+		compute(count, countOffset, args, argsOffset, shader.getReflection().getLocalSizeX());
+	}
+
+	DispatchHandle computeAsync(ComputeBuffer& count, vk::DeviceSize countOffset, ComputeBuffer& args, vk::DeviceSize argsOffset, uint32_t localSize){
+		if(countOffset % 4 || argsOffset % 4) assert(0 && "Error: Count and argument offsets must be multiples of 4!");
+		if(!localSize) assert(0 && "Error: Invalid local size!");
+
+		shader.bindComputeBuffer(count, 0);
+		shader.bindComputeBuffer(args, 1);
+		Params params = { uint32_t(countOffset / 4), uint32_t(argsOffset / 4), localSize, context.deviceProperties.limits.maxComputeWorkGroupCount[0] };
+		shader.setPushConstants(params);
+
+		return shader.dispatchAsync(1);
+	}
+};
+
+#endif // __WORKGROUP_COUNT_KERNEL_VULK_H__
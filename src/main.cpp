@@ -8,13 +8,28 @@
 #include "OpenGL/DictionaryComputeBuffer.hpp"
 #else
 #include "Vulkan/ComputeShader.hpp"
+#include "Vulkan/ComputeSequence.hpp"
 #include "Vulkan/DictionaryComputeBuffer.hpp"
+#include "Vulkan/TransferBatch.hpp"
+#include "Vulkan/MirroredComputeBuffer.hpp"
+#include "Vulkan/StreamingExecutor.hpp"
+#include "Vulkan/WorkgroupCountKernel.hpp"
+#include "Vulkan/DeviceAddressTable.hpp"
+#include "Vulkan/ShaderCompiler.hpp"
 #endif
 
 #include <iomanip>
 
 using namespace std;
 
+// Compares results computed on the GPU against the ones computed on the CPU, printing whether they match
+template <class T>
+static bool check(const string& name, const vector<T>& got, const vector<T>& expected){
+	bool passed = got == expected;
+	cout << name << ": " << (passed ? "passed" : "FAILED") << endl;
+	return passed;
+}
+
 int main(){
 	Dictionary d;
 	d["bob"] = 21.0;
@@ -36,6 +51,7 @@ int main(){
 	vector<unsigned int> data;
 	for(int i = 1; i <= 1024; i++)
 		data.push_back(i);
+	int failures = 0;
 
 
 #ifdef USE_GL // OpenGL Code
@@ -113,21 +129,26 @@ int main(){
 			// // Multiply our data
 			ComputeShader multiply(c, multiplyFile);
 			multiply.bindComputeBuffer(inBuffer);
-			multiply.dispatch(1024 / 32);
 
 			// Reverse our data
 			ComputeShader reverse(c, reverseFile);
 			reverse.bindComputeBuffer(inBuffer);
 			reverse.bindComputeBuffer(outBuffer);
-			struct PushConstants {
-				bool shouldFlip;
-			} gpuData;
-			gpuData.shouldFlip = true;
-			reverse.setPushConstants(gpuData);
-			reverse.dispatch(1024 / 32);
+			reverse.setPushConstant("shouldFlip", true);
+
+			// Run both shaders in a single submission
+			ComputeSequence sequence(c);
+			sequence.dispatchElements(multiply, data.size());
+			sequence.dispatchElements(reverse, data.size());
+			sequence.submit();
+
+			// The output should be the tripled data in reverse order
+			vector<unsigned int> expected(data.rbegin(), data.rend());
+			for(unsigned int& value: expected) value *= 3;
 
 			// Pull the data from the outbuffer
 			outBuffer.getData(data);
+			failures += !check("ComputeSequence", data, expected);
 		}
 
 		// Print out the start of the data
@@ -138,10 +159,504 @@ int main(){
 		}
 
 		cout << endl;
+
+
+		// Test asynchronous dispatches: run two kernels on separate buffers at once, waiting on their handles only after
+		//  both have been submitted
+		{
+			const char* source = R"(#version 430
+layout(local_size_x = 32) in;
+layout(std430, binding = 0) buffer Data { uint values[]; };
+layout(push_constant) uniform Params { uint factor; };
+
+void main() {
+	values[gl_GlobalInvocationID.x] *= factor;
+}
+)";
+			ComputeShader doubler(c, std::string(source)), tripler(c, std::string(source));
+			vector<uint32_t> values(1024), results, expected;
+			for(uint32_t i = 0; i < values.size(); i++) values[i] = i + 7;
+			ComputeBuffer first(c, 0, values), second(c, 0, values);
+			doubler.bindComputeBuffer(first);
+			doubler.setPushConstant("factor", 2u);
+			tripler.bindComputeBuffer(second);
+			tripler.setPushConstant("factor", 3u);
+
+			vector<uint32_t> finished;
+			DispatchHandle a = doubler.dispatchElementsAsync(values.size());
+			DispatchHandle b = tripler.dispatchElementsAsync(values.size());
+			a.then([&]{ finished.push_back(2); });
+			b.then([&]{ finished.push_back(3); });
+			b.wait();
+			a.wait();
+
+			vector<uint32_t> result(values.size());
+			first.getData(result);
+			results.insert(results.end(), result.begin(), result.end());
+			second.getData(result);
+			results.insert(results.end(), result.begin(), result.end());
+			for(uint32_t value: values) expected.push_back(value * 2);
+			for(uint32_t value: values) expected.push_back(value * 3);
+			failures += !check("Asynchronous dispatch", results, expected);
+			// Both callbacks should have run once their dispatches finished
+			std::sort(finished.begin(), finished.end());
+			failures += !check("Asynchronous dispatch (callbacks)", finished, vector<uint32_t>{2, 3});
+		}
+
+		// Test ShaderCompiler: compile a kernel on the worker pool alongside a broken one, which should report its error
+		//  through its future
+		{
+			ShaderCompiler compiler(c);
+			auto futures = compiler.compile({ std::string(R"(#version 430
+layout(local_size_x = 32) in;
+layout(std430, binding = 0) buffer Data { uint values[]; };
+
+void main() {
+	values[gl_GlobalInvocationID.x] = values[gl_GlobalInvocationID.x] * 4u + 1u;
+}
+)"), std::string(R"(#version 430
+layout(local_size_x = 32) in;
+void main() { this is not glsl; }
+)") });
+
+			vector<uint32_t> values(512), result(values.size()), expected(values.size());
+			for(uint32_t i = 0; i < values.size(); i++){
+				values[i] = i;
+				expected[i] = i * 4 + 1;
+			}
+			ComputeBuffer buffer(c, 0, values);
+			std::unique_ptr<ComputeShader> shader = futures[0].get();
+			shader->bindComputeBuffer(buffer);
+			shader->dispatchElements(values.size());
+			buffer.getData(result);
+			failures += !check("ShaderCompiler", result, expected);
+
+			bool threw = false;
+			try { futures[1].get(); } catch(const std::exception&) { threw = true; }
+			failures += !check("ShaderCompiler (error)", vector<bool>{threw}, vector<bool>{true});
+		}
+
+		// Test the staging ring: queue more uploads than fit in the ring at once, so it wraps around (retiring the oldest
+		//  transfers) while several others are still in flight
+		{
+			const vk::DeviceSize piece = 3 * 1024 * 1024 / sizeof(uint32_t), pieces = 12;
+			vector<uint32_t> values(piece * pieces), result(values.size());
+			for(uint32_t i = 0; i < values.size(); i++) values[i] = i ^ 0x5A5A5A5A;
+			ComputeBuffer buffer(c, 0, values.size() * sizeof(uint32_t), nullptr, 0, 0, ComputeBuffer::Residency::DeviceLocal);
+
+			vector<TransferHandle> uploads;
+			for(vk::DeviceSize p = 0; p < pieces; p++)
+				uploads.push_back(buffer.setDataAsync(values.data() + p * piece, p * piece * sizeof(uint32_t), (p + 1) * piece * sizeof(uint32_t)));
+			for(TransferHandle& upload: uploads) upload.wait();
+
+			// Read it back through a future, which finishes the transfer from a thread of its own
+			std::future<void> readback = buffer.getDataAsync(result).future();
+			readback.wait();
+			failures += !check("StagingRing (wrap around)", result, values);
+		}
+
+		// Test TransferBatch: scatter regions into two buffers in one submission, then gather them back
+		{
+			ComputeBuffer a(c, 0, 256 * sizeof(uint32_t)), b(c, 1, 128 * sizeof(uint32_t));
+			vector<uint32_t> aData(256), bData(128);
+			for(uint32_t i = 0; i < aData.size(); i++) aData[i] = i * 7;
+			for(uint32_t i = 0; i < bData.size(); i++) bData[i] = 1000 + i;
+
+			TransferBatch batch(c);
+			batch.upload(a, aData.data(), 0, 100 * sizeof(uint32_t));
+			batch.upload(a, aData.data() + 100, 100 * sizeof(uint32_t), 156 * sizeof(uint32_t));
+			batch.upload(b, bData.data(), 0, bData.size() * sizeof(uint32_t));
+			batch.submit();
+
+			vector<uint32_t> aResult(aData.size()), bResult(bData.size());
+			batch.download(b, bResult.data(), 0, bResult.size() * sizeof(uint32_t));
+			batch.download(a, aResult.data() + 128, 128 * sizeof(uint32_t), 128 * sizeof(uint32_t));
+			batch.download(a, aResult.data(), 0, 128 * sizeof(uint32_t));
+			batch.submit();
+
+			failures += !check("TransferBatch", aResult, aData);
+			failures += !check("TransferBatch (second buffer)", bResult, bData);
+
+			// Overlapping uploads to one buffer land in the order they were queued
+			vector<uint32_t> patch(64, 0xABCD);
+			batch.upload(a, aData.data(), 0, aData.size() * sizeof(uint32_t));
+			batch.upload(a, patch.data(), 50 * sizeof(uint32_t), patch.size() * sizeof(uint32_t));
+			batch.upload(a, aData.data() + 100, 100 * sizeof(uint32_t), 4 * sizeof(uint32_t));
+			batch.download(a, aResult.data(), 0, aResult.size() * sizeof(uint32_t));
+			batch.submit();
+			vector<uint32_t> expected = aData;
+			for(uint32_t i = 50; i < 114; i++) expected[i] = 0xABCD;
+			for(uint32_t i = 100; i < 104; i++) expected[i] = aData[i];
+			failures += !check("TransferBatch (overlapping uploads)", aResult, expected);
+		}
+
+		// Test MirroredComputeBuffer: only the pages written on the host should be uploaded before the next dispatch
+		{
+			vector<uint32_t> values(1024);
+			for(uint32_t i = 0; i < values.size(); i++) values[i] = i;
+			MirroredComputeBuffer mirrored(c, 1, values, /*pageSize*/ 256);
+
+			ifstream file("src/multiplyShader.glsl");
+			ComputeShader multiply(c, file);
+			multiply.bindComputeBuffer(mirrored);
+			multiply.dispatchElements(values.size());
+
+			// Pull the tripled values back, change two of them, and triple everything again
+			mirrored.pull();
+			auto view = mirrored.view<uint32_t>();
+			view[5] = 1;
+			view[700] = 2;
+			multiply.dispatchElements(values.size());
+
+			vector<uint32_t> expected(values.size()), result(values.size());
+			for(uint32_t i = 0; i < values.size(); i++) expected[i] = values[i] * 9;
+			expected[5] = 3;
+			expected[700] = 6;
+			mirrored.getData(result);
+			failures += !check("MirroredComputeBuffer", result, expected);
+		}
+
+		// Test StreamingExecutor: stream more data than fits in one chunk (ending with a short chunk) through a kernel
+		{
+			ComputeShader scale(c, std::string(R"(#version 430
+layout(local_size_x = 64) in;
+layout(std430, binding = 0) readonly buffer Input { uint inData[]; };
+layout(std430, binding = 1) writeonly buffer Output { uint outData[]; };
+layout(push_constant) uniform Chunk { uint chunkOffset; uint chunkElements; uint chunkOffsetHigh; };
+
+void main() {
+	uint i = gl_GlobalInvocationID.x;
+	if(i >= chunkElements) return;
+	outData[i] = inData[i] * 2u + chunkOffset + i;
+}
+)"));
+			vector<uint32_t> input(10000), output(input.size()), expected(input.size());
+			for(uint32_t i = 0; i < input.size(); i++){
+				input[i] = i * 3 + 1;
+				expected[i] = input[i] * 2 + i;
+			}
+
+			StreamingExecutor executor(c, scale, 0, 1, /*chunkSize*/ 1024 * sizeof(uint32_t), sizeof(uint32_t), 64);
+			HostSource source(input);
+			HostSink sink(output);
+			executor.run(source, sink);
+			failures += !check("StreamingExecutor", output, expected);
+		}
+
+		// Test ComputeBufferPool: buffers leased at sizes between size classes, replaced (and recycled) every round with a
+		//  smaller size in the same class (which the shader should see through the length of its arrays)
+		{
+			ComputeShader add(c, std::string(R"(#version 430
+layout(local_size_x = 32) in;
+layout(std430, binding = 0) readonly buffer Input { uint inData[]; };
+layout(std430, binding = 1) writeonly buffer Output { uint outData[]; };
+layout(push_constant) uniform Params { uint amount; };
+
+void main() {
+	uint i = gl_GlobalInvocationID.x;
+	if(i < uint(inData.length())) outData[i] = inData[i] + amount + uint(inData.length());
+}
+)"));
+			ComputeBufferPool pool(c);
+			vector<uint32_t> results, expected;
+
+			for(uint32_t round = 0; round < 3; round++){
+				vector<uint32_t> values(250 - round * 40), result(values.size());
+				for(uint32_t i = 0; i < values.size(); i++) values[i] = i * i;
+
+				// Replacing the buffers gives the previous round's back to the pool
+				ComputeBuffer& in = add.createComputeBuffer(pool, values.size() * sizeof(uint32_t), 0);
+				ComputeBuffer& out = add.createComputeBuffer(pool, values.size() * sizeof(uint32_t), 1);
+				in.setData(values);
+				add.setPushConstant("amount", round);
+				add.dispatchElements(values.size());
+				out.getData(result);
+
+				results.insert(results.end(), result.begin(), result.end());
+				for(uint32_t value: values) expected.push_back(value + round + values.size());
+			}
+			failures += !check("ComputeBufferPool", results, expected);
+			// Only the first round should have created buffers
+			ComputeBufferPool::Stats stats = pool.getStats();
+			failures += !check("ComputeBufferPool (reuse)", vector<uint64_t>{stats.hits, stats.misses}, vector<uint64_t>{4, 2});
+		}
+
+		// Test ComputeSequence copies and fills: fill a buffer, copy part of another into it, triple it, and copy the
+		//  result out (each step depends on the one before it)
+		{
+			vector<uint32_t> values(256);
+			for(uint32_t i = 0; i < values.size(); i++) values[i] = i + 1;
+			ComputeBuffer source(c, 0, values), work(c, 1, values.size() * sizeof(uint32_t)), result(c, 2, values.size() * sizeof(uint32_t));
+
+			ifstream file("src/multiplyShader.glsl");
+			ComputeShader multiply(c, file);
+			multiply.bindComputeBuffer(work);
+
+			ComputeSequence sequence(c);
+			sequence.fill(work, 7);
+			sequence.copy(work, source, /*srcOffset*/ 0, /*dstOffset*/ 16 * sizeof(uint32_t), 100 * sizeof(uint32_t));
+			sequence.dispatchElements(multiply, values.size());
+			sequence.copy(result, work);
+			sequence.submit();
+
+			vector<uint32_t> expected(values.size(), 7 * 3), got(values.size());
+			for(uint32_t i = 0; i < 100; i++) expected[16 + i] = values[i] * 3;
+			result.getData(got);
+			failures += !check("ComputeSequence (copy and fill)", got, expected);
+		}
+
+		// Test indirect dispatch: size a kernel from an element count stored on the GPU
+		{
+			// The first count is more than the largest dispatch the device supports can cover
+			vector<uint32_t> counts = {0xFFFFFFFF, 1000};
+			ComputeBuffer count(c, 0, counts);
+			ComputeBuffer args(c, 1, 4 * sizeof(uint32_t), vk::BufferUsageFlagBits::eIndirectBuffer), overflow(c, 1, 4 * sizeof(uint32_t));
+			ComputeBuffer out(c, 1, 1100 * sizeof(uint32_t));
+			out.fill(0xFFFFFFFF);
+
+			ComputeShader write(c, std::string(R"(#version 430
+layout(local_size_x = 32) in;
+layout(std430, binding = 0) readonly buffer Counts { uint counts[]; };
+layout(std430, binding = 1) writeonly buffer Output { uint outData[]; };
+
+void main() {
+	uint i = gl_GlobalInvocationID.x;
+	if(i < counts[1]) outData[i] = i * 2u;
+}
+)"));
+			write.bindComputeBuffer(count, 0);
+			write.bindComputeBuffer(out, 1);
+
+			WorkgroupCountKernel counter(c);
+			counter.compute(count, /*countOffset*/ sizeof(uint32_t), args, 0, write);
+			write.dispatchIndirect(args);
+			counter.compute(count, 0, overflow, 0, 32);
+
+			vector<uint32_t> groups(4), clamped(4), result(1100), expected(1100, 0xFFFFFFFF);
+			for(uint32_t i = 0; i < 1000; i++) expected[i] = i * 2;
+			args.getData(groups);
+			overflow.getData(clamped);
+			out.getData(result);
+			uint64_t needed = (0xFFFFFFFFull + 31) / 32;
+			uint32_t dispatched = uint32_t(std::min<uint64_t>(needed, c.deviceProperties.limits.maxComputeWorkGroupCount[0]));
+			uint32_t dropped = needed > dispatched ? 0xFFFFFFFF - dispatched * 32 : 0;
+			failures += !check("WorkgroupCountKernel", groups, vector<uint32_t>{(1000 + 31) / 32, 1, 1, 0});
+			failures += !check("WorkgroupCountKernel (overflow)", clamped, vector<uint32_t>{dispatched, 1, 1, dropped});
+			failures += !check("Indirect dispatch", result, expected);
+		}
+
+		// Test specialization: two variants of one shader with different workgroup sizes and factors
+		{
+			ComputeShader scale(c, std::string(R"(#version 430
+layout(local_size_x_id = 0) in;
+layout(constant_id = 1) const uint factor = 1u;
+layout(std430, binding = 0) buffer Data { uint values[]; };
+layout(push_constant) uniform Params { uint count; };
+
+void main() {
+	uint i = gl_GlobalInvocationID.x;
+	if(i < count) values[i] *= factor;
+}
+)"));
+			vector<uint32_t> values(1000), result(values.size()), expected(values.size());
+			for(uint32_t i = 0; i < values.size(); i++){
+				values[i] = i;
+				expected[i] = i * 5 * 2;
+			}
+			ComputeBuffer buffer(c, 0, values);
+			scale.bindComputeBuffer(buffer);
+			scale.setPushConstant("count", uint32_t(values.size()));
+
+			// The group counts come from each variant's own local size
+			scale.specialize({ {0, 64}, {1, 5} }).dispatchElements(values.size());
+			scale.specialize({ {0, 128}, {1, 2} }).dispatchElements(values.size());
+			buffer.getData(result);
+			failures += !check("Specialization", result, expected);
+		}
+
+		// Test push descriptors: rebind the shader's buffers between dispatches (the buffers are pushed into each
+		//  recording if the device supports it, otherwise cached descriptor sets are used)
+		{
+			ComputeShader increment(c, std::string(R"(#version 430
+layout(local_size_x = 32) in;
+layout(std430, binding = 0) readonly buffer Input { uint inData[]; };
+layout(std430, binding = 1) writeonly buffer Output { uint outData[]; };
+
+void main() {
+	outData[gl_GlobalInvocationID.x] = inData[gl_GlobalInvocationID.x] + 1u;
+}
+)"));
+			cout << "Push descriptors: " << (increment.usesPushDescriptors() ? "enabled" : "unsupported") << endl;
+
+			vector<uint32_t> first(256), second(256), results, expected;
+			for(uint32_t i = 0; i < first.size(); i++){
+				first[i] = i;
+				second[i] = 5000 + i;
+			}
+			ComputeBuffer inA(c, 0, first), inB(c, 0, second);
+			ComputeBuffer outA(c, 1, first.size() * sizeof(uint32_t)), outB(c, 1, second.size() * sizeof(uint32_t));
+
+			// A -> A, B -> B, then B's output back into A's input
+			increment.bindComputeBuffer(inA);
+			increment.bindComputeBuffer(outA);
+			increment.dispatchElements(first.size());
+			increment.bindComputeBuffer(inB);
+			increment.bindComputeBuffer(outB);
+			increment.dispatchElements(second.size());
+			increment.bindComputeBuffer(outB, 0);
+			increment.bindComputeBuffer(outA, 1);
+			increment.dispatchElements(second.size());
+
+			vector<uint32_t> result(first.size());
+			outA.getData(result);
+			results.insert(results.end(), result.begin(), result.end());
+			for(uint32_t value: second) expected.push_back(value + 2);
+			inA.getData(result);
+			results.insert(results.end(), result.begin(), result.end());
+			expected.insert(expected.end(), first.begin(), first.end());
+			failures += !check("Push descriptors", results, expected);
+		}
+
+		// Test device addresses: sum buffers the shader reaches through a DeviceAddressTable, then repoint an entry
+		if(c.bufferDeviceAddress){
+			ComputeShader sum(c, std::string(R"(#version 430
+#extension GL_EXT_buffer_reference : require
+layout(local_size_x = 32) in;
+layout(buffer_reference, std430) buffer Values { uint values[]; };
+layout(std430, binding = 0) readonly buffer Table { Values tables[]; };
+layout(std430, binding = 1) writeonly buffer Output { uint outData[]; };
+layout(push_constant) uniform Params { uint tableCount; };
+
+void main() {
+	uint i = gl_GlobalInvocationID.x, total = 0u;
+	for(uint t = 0u; t < tableCount; t++)
+		total += tables[t].values[i];
+	outData[i] = total;
+}
+)"));
+			const uint32_t n = 128;
+			vector<vector<uint32_t>> values(4, vector<uint32_t>(n));
+			for(uint32_t b = 0; b < values.size(); b++)
+				for(uint32_t i = 0; i < n; i++)
+					values[b][i] = (b + 1) * 1000 + i;
+			ComputeBuffer b0(c, 2, values[0]), b1(c, 2, values[1]), b2(c, 2, values[2]), b3(c, 2, values[3]);
+			ComputeBuffer out(c, 1, n * sizeof(uint32_t));
+
+			DeviceAddressTable table(c, 0, {&b0, &b1, &b2});
+			sum.bindComputeBuffer(table);
+			sum.bindComputeBuffer(out);
+			sum.setAddressTable(table);
+			sum.setPushConstant("tableCount", uint32_t(3));
+
+			vector<uint32_t> result(n), results, expected;
+			sum.dispatchElements(n);
+			out.getData(result);
+			results.insert(results.end(), result.begin(), result.end());
+			for(uint32_t i = 0; i < n; i++) expected.push_back(values[0][i] + values[1][i] + values[2][i]);
+
+			table.set(1, b3);
+			sum.dispatchElements(n);
+			out.getData(result);
+			results.insert(results.end(), result.begin(), result.end());
+			for(uint32_t i = 0; i < n; i++) expected.push_back(values[0][i] + values[3][i] + values[2][i]);
+			failures += !check("Device addresses", results, expected);
+		} else cout << "Device addresses: unsupported" << endl;
+
+		// Test uniform blocks: a block larger than push constants allow, set as a whole and then member by member in a
+		//  loop (cycling through the shader's ring of copies), and changed between submissions of a sequence
+		{
+			ComputeShader weigh(c, std::string(R"(#version 430
+layout(local_size_x = 32) in;
+layout(std430, binding = 0) readonly buffer Input { uint inData[]; };
+layout(std430, binding = 1) writeonly buffer Output { uint outData[]; };
+layout(std140, set = 1, binding = 0) uniform Params { vec4 weights[8]; uint offset; float scale; };
+
+void main() {
+	uint i = gl_GlobalInvocationID.x;
+	outData[i] = uint(float(inData[i]) * scale) + offset + uint(weights[i % 8u].x);
+}
+)"));
+			// Matches the block's std140 layout
+			struct Params {
+				float weights[8][4];
+				uint32_t offset;
+				float scale;
+			} params = {};
+			for(uint32_t w = 0; w < 8; w++) params.weights[w][0] = float(w * 100);
+			params.scale = 2;
+
+			const uint32_t n = 256;
+			vector<uint32_t> values(n), result(n), results, expected;
+			for(uint32_t i = 0; i < n; i++) values[i] = i;
+			ComputeBuffer in(c, 0, values), out(c, 1, n * sizeof(uint32_t));
+			weigh.bindComputeBuffer(in);
+			weigh.bindComputeBuffer(out);
+			weigh.setUniforms(params);
+
+			auto expect = [&](uint32_t offset){
+				for(uint32_t i = 0; i < n; i++) expected.push_back(values[i] * 2 + offset + (i % 8) * 100);
+			};
+			for(uint32_t offset = 0; offset < 20; offset++){
+				weigh.setUniform("offset", offset);
+				weigh.dispatchElements(n);
+				out.getData(result);
+				results.insert(results.end(), result.begin(), result.end());
+				expect(offset);
+			}
+			failures += !check("Uniform blocks", results, expected);
+
+			// The sequence keeps its own copies of the block, so the shader's values can change independently
+			results.clear();
+			expected.clear();
+			ComputeSequence sequence(c);
+			size_t step = sequence.dispatchElements(weigh, n);
+			weigh.setUniform("offset", 12345u);
+			for(uint32_t offset = 100; offset < 103; offset++){
+				params.offset = offset;
+				sequence.setUniforms(step, params);
+				sequence.submit();
+				out.getData(result);
+				results.insert(results.end(), result.begin(), result.end());
+				expect(offset);
+			}
+			failures += !check("Uniform blocks (sequence)", results, expected);
+		}
+
+		// Test changing a sequence's push constants between submissions which are still in flight
+		{
+			ComputeShader accumulate(c, std::string(R"(#version 430
+layout(local_size_x = 32) in;
+layout(std430, binding = 0) buffer Data { uint values[]; };
+layout(push_constant) uniform Params { uint amount; };
+
+void main() {
+	values[gl_GlobalInvocationID.x] += amount;
+}
+)"));
+			vector<uint32_t> values(256), result(values.size()), expected(values.size());
+			for(uint32_t i = 0; i < values.size(); i++){
+				values[i] = i;
+				expected[i] = i + 1 + 2 + 3 + 4 + 5 + 6;
+			}
+			ComputeBuffer buffer(c, 0, values);
+			accumulate.bindComputeBuffer(buffer);
+			accumulate.setPushConstant("amount", 0u);
+
+			ComputeSequence sequence(c);
+			size_t step = sequence.dispatchElements(accumulate, values.size());
+			DispatchHandle last;
+			for(uint32_t amount = 1; amount <= 6; amount++){
+				sequence.setPushConstants(step, amount);
+				last = sequence.submitAsync();
+			}
+			last.wait();
+			buffer.getData(result);
+			failures += !check("ComputeSequence (push constants)", result, expected);
+		}
 	}
 	multiplyFile.close();
 	reverseFile.close();
 	cout << endl << "Terminatation Sucessful!" << endl;
 #endif
-	return 0;
+	return failures ? 1 : 0;
 }
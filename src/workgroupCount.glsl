@@ -0,0 +1,24 @@
+#version 430
+layout(local_size_x = 1) in;
+layout(std430, binding = 0) readonly buffer CountBuffer { uint counts[]; };
+layout(std430, binding = 1) writeonly buffer ArgsBuffer { uint args[]; };
+
+// Parameters are push constants under Vulkan and uniforms under OpenGL
+#ifdef VK_ENABLED
+layout(push_constant) uniform Params { uint countIndex; uint argsIndex; uint localSize; uint maxGroups; };
+#else
+uniform int countIndex, argsIndex, localSize, maxGroups;
+#endif
+
+// Writes the x, y, z group counts followed by the number of elements which didn't fit in the largest dispatch the
+//  device supports (0 if every element is covered)
+void main() {
+	uint count = counts[uint(countIndex)];
+	// Rounded up without adding to the count, so counts near the limit of a uint don't wrap
+	uint groups = count / uint(localSize) + (count % uint(localSize) != 0u ? 1u : 0u);
+	uint dispatched = min(groups, uint(maxGroups));
+	args[uint(argsIndex)] = dispatched;
+	args[uint(argsIndex) + 1u] = 1u;
+	args[uint(argsIndex) + 2u] = 1u;
+	args[uint(argsIndex) + 3u] = groups > dispatched ? count - dispatched * uint(localSize) : 0u;
+}